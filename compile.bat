@@ -3,8 +3,8 @@
 set CompileFlags= -nologo -Zi -GR- -Gm- -EHsc- -W4 -I../include -I../src -wd4100 -wd4189 -D_CRT_SECURE_NO_WARNINGS -DEBUG -O2 -Zo
 set LinkFlags= -INCREMENTAL:NO
 
-set HarnessSrcFiles=..\src\main.cpp ..\src\fundmatch.cpp ..\src\dataio.cpp ..\src\logging.cpp ..\src\Jzon.cpp
-set HarnessObjFiles=main.obj fundmatch.obj dataio.obj logging.obj Jzon.obj
+set HarnessSrcFiles=..\src\main.cpp ..\src\pipeline.cpp ..\src\daemon.cpp ..\src\fundmatch.cpp ..\src\ledger.cpp ..\src\polish.cpp ..\src\candidates.cpp ..\src\presolve.cpp ..\src\decompose.cpp ..\src\horizon.cpp ..\src\incremental.cpp ..\src\greedy.cpp ..\src\flow.cpp ..\src\bounds.cpp ..\src\sourceindex.cpp ..\src\dataio.cpp ..\src\logging.cpp ..\src\Jzon.cpp
+set HarnessObjFiles=main.obj pipeline.obj daemon.obj fundmatch.obj ledger.obj polish.obj candidates.obj presolve.obj decompose.obj horizon.obj incremental.obj greedy.obj flow.obj bounds.obj sourceindex.obj dataio.obj logging.obj Jzon.obj
 
 
 IF NOT EXIST build mkdir build
@@ -26,4 +26,13 @@ cl %CompileFlags% ..\src\heuristic.cpp %HarnessObjFiles% -link %LinkFlags%
 
 REM Worst-case
 cl %CompileFlags% ..\src\worstcase.cpp %HarnessObjFiles% -link %LinkFlags%
+
+REM Min-cost flow
+cl %CompileFlags% ..\src\mcf.cpp %HarnessObjFiles% -link %LinkFlags%
+
+REM GRASP
+cl %CompileFlags% ..\src\grasp.cpp %HarnessObjFiles% -link %LinkFlags%
+
+REM Daemon client
+cl %CompileFlags% ..\src\client.cpp Jzon.obj -link %LinkFlags%
 popd
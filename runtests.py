@@ -1,6 +1,5 @@
 from subprocess import check_output
 from os.path import isfile
-import time
 import argparse
 import re
 import os
@@ -13,6 +12,8 @@ if __name__ == "__main__":
     parser.add_argument("-i", "--iterations", default=3, type=int)
     parser.add_argument("-ds", "--data-set", default=["DSg_1"], type=str, nargs="*")
     parser.add_argument("-m", "--method", default=["heuristic"], type=str, nargs="*")
+    parser.add_argument("-j", "--jobs", default=1, type=int)
+    parser.add_argument("-nb", "--no-bound", action="store_true")
     args = parser.parse_args()
 
     fitness_plot_file = open("fitness_comparison.dat", "w")
@@ -46,7 +47,8 @@ if __name__ == "__main__":
                 ds_requirement_count[index] = require_text.count("\n")-1
 
     for req_count, data_set in zip(ds_requirement_count, args.data_set):
-        worstcaseOutput = check_output(["./build/worstcase", data_set]).decode()
+        # NOTE: The baseline never needs the lower bound
+        worstcaseOutput = check_output(["./build/worstcase", data_set, "--no-bound"]).decode()
         regexMatch = re.search(r"fitness was (-?\d+\.\d+) from (\d+) allocations", worstcaseOutput)
         worstFitness = float(regexMatch.group(1))
         print("Running tests for dataset %s, normalized to %.2f" % (data_set, worstFitness))
@@ -57,21 +59,38 @@ if __name__ == "__main__":
             fitnesses = []
             runtimes = []
             allocCounts = []
+            gaps = []
+            # NOTE: All of the iterations run in a single batch, which only loads the data set once
+            command = ["./build/%s" % method, data_set, "--repeat", str(iterations),
+                       "--jobs", str(args.jobs)]
+            if args.no_bound:
+                command.append("--no-bound")
+            output = check_output(command).decode()
             for i in range(iterations):
-                startTime = time.time()
-                output = check_output(["./build/%s" % method, data_set]).decode()
+                if iterations == 1:
+                    label = ""
+                    batchFileName = "output.json"
+                else:
+                    label = re.escape("%s #%d: " % (data_set, i+1))
+                    batchFileName = "output_%s_%d.json" % (data_set, i+1)
                 outputFileName = "output_%s_%s_%d.json" % (method, data_set, i+1)
                 if os.path.exists(outputFileName):
                     os.remove(outputFileName)
-                os.rename("output.json", outputFileName)
-                endTime = time.time()
-                regexMatch = re.search(r"fitness was (-?\d+\.\d+) from (\d+) allocations", output)
-                fitness = float(regexMatch.group(1))
-                allocCount = int(regexMatch.group(2))
+                os.rename(batchFileName, outputFileName)
+                resultPattern = (r"^%sOptimization completed in (\d+\.\d+)s - "
+                                 r"final fitness was (-?\d+\.\d+) from (\d+) allocations" % label)
+                regexMatch = re.search(resultPattern, output, re.MULTILINE)
+                runtime = float(regexMatch.group(1))
+                fitness = float(regexMatch.group(2))
+                allocCount = int(regexMatch.group(3))
+                gapMatch = re.search(r"^%s.*with a gap of (\d+\.\d+)%%$" % label, output,
+                                     re.MULTILINE)
                 if(fitness > 0):
                     fitnesses.append(fitness)
-                    runtimes.append(endTime-startTime)
+                    runtimes.append(runtime)
                     allocCounts.append(allocCount)
+                    if gapMatch:
+                        gaps.append(float(gapMatch.group(1)))
                 print("\tIteration %d: %f" % (i, fitness))
 
             minFitness = maxFitness = avgFitness = 0
@@ -91,6 +110,8 @@ if __name__ == "__main__":
             alloc_count_plot_file.write(" %.2f %.2f %.2f" % (avgAllocs, minAllocs, maxAllocs))
             runtime_plot_file.write(" %.2f %.2f %.2f" % (avgRuntime, minRuntime, maxRuntime))
             print("\tAverage fitness: %.2f" % avg(fitnesses))
+            if len(gaps) > 0:
+                print("\tAverage gap to lower bound: %.2f%%" % avg(gaps))
             print("") # Get us an empty line
         for f in plot_files:
             f.write("\n")
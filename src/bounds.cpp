@@ -0,0 +1,36 @@
+#include <float.h>
+
+#include "bounds.h"
+#include "flow.h"
+#include "fundmatch.h"
+
+float computeLowerBound(ProblemInstance& problem)
+{
+    problem.lowerBound = (float)solveMonthlyRelaxation(problem.input, true, nullptr);
+    return problem.lowerBound;
+}
+
+bool hasLowerBound(const ProblemInstance& problem)
+{
+    return problem.lowerBound > -FLT_MAX;
+}
+
+float computeOptimalityGap(const ProblemInstance& problem, float fitness)
+{
+    if((fitness == FLT_MAX) || (fitness <= 0.0f))
+        return FLT_MAX;
+
+    // NOTE: The bound is computed in doubles, so it can come out a tiny bit above an optimal
+    //       solution's fitness as computed in floats
+    float gap = 100.0f*(fitness - problem.lowerBound)/fitness;
+    if(gap < 0.0f)
+        gap = 0.0f;
+    return gap;
+}
+
+bool hasReachedGapTarget(const ProblemInstance& problem, float fitness)
+{
+    if((problem.options.gapTarget <= 0.0f) || !hasLowerBound(problem))
+        return false;
+    return computeOptimalityGap(problem, fitness) <= problem.options.gapTarget;
+}
@@ -0,0 +1,24 @@
+#ifndef _BOUNDS_H
+#define _BOUNDS_H
+
+#include "fundmatch.h"
+
+// Computes a lower bound on the fitness of every feasible solution to the given problem (from the
+// monthly relaxation, with balance pools included), and stores it in the problem for the functions
+// below to compare to. Returns the lower bound.
+// NOTE: This must be called before any of the functions below, and before any solver threads
+//       start, after which the bound is only ever read
+float computeLowerBound(ProblemInstance& problem);
+
+// Returns true iff the problem's lower bound has been computed
+bool hasLowerBound(const ProblemInstance& problem);
+
+// Returns how far the given fitness is above the problem's lower bound, as a percentage of the
+// fitness
+float computeOptimalityGap(const ProblemInstance& problem, float fitness);
+
+// Returns true iff the problem has a gap target and the given fitness is within it, IE a solver
+// that has found a solution with this fitness can stop
+bool hasReachedGapTarget(const ProblemInstance& problem, float fitness);
+
+#endif // _BOUNDS_H
@@ -0,0 +1,366 @@
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "candidates.h"
+#include "fundmatch.h"
+#include "greedy.h"
+#include "parallel.h"
+
+using namespace std;
+
+struct OverlapPair
+{
+    int requirementIndex;
+    int sourceIndex;
+};
+
+static int sourceEndDate(const InputData& input, int srcIndex)
+{
+    return input.sources[srcIndex].startDate + input.sources[srcIndex].tenor;
+}
+
+static int requirementEndDate(const InputData& input, int reqIndex)
+{
+    return input.requirements[reqIndex].startDate + input.requirements[reqIndex].tenor;
+}
+
+// Finds every source and requirement of the given input and tax class that overlap by at least a
+// month, and calls handlePair(reqIndex, srcIndex) for each of them.
+// NOTE: This sweeps over the sources and requirements in order of start date, keeping a list of
+//       those that have started but not yet ended. Each new source/requirement overlaps exactly the
+//       requirements/sources that are still in the list when it starts, so we only ever look at
+//       pairs that actually overlap (apart from removing each one from its list once it has ended).
+template<typename PairHandler>
+static void joinOverlapping(const InputData& input, TaxClass taxClass, PairHandler handlePair)
+{
+    vector<int> sources;
+    for(int srcIndex=0; srcIndex<(int)input.sources.size(); srcIndex++)
+    {
+        const SourceInfo& src = input.sources[srcIndex];
+        if((src.taxClass == taxClass) && (src.tenor >= 1))
+            sources.push_back(srcIndex);
+    }
+    vector<int> requirements;
+    for(int reqIndex=0; reqIndex<(int)input.requirements.size(); reqIndex++)
+    {
+        const RequirementInfo& req = input.requirements[reqIndex];
+        if((req.taxClass == taxClass) && (req.tenor >= 1))
+            requirements.push_back(reqIndex);
+    }
+    sort(sources.begin(), sources.end(), [&input](int a, int b)
+    {
+        return input.sources[a].startDate < input.sources[b].startDate;
+    });
+    sort(requirements.begin(), requirements.end(), [&input](int a, int b)
+    {
+        return input.requirements[a].startDate < input.requirements[b].startDate;
+    });
+
+    vector<int> activeSources;
+    vector<int> activeRequirements;
+    int sourcePos = 0;
+    int reqPos = 0;
+    int sourceCount = (int)sources.size();
+    int reqCount = (int)requirements.size();
+    while((sourcePos < sourceCount) || (reqPos < reqCount))
+    {
+        // NOTE: It doesn't matter which comes first when a source and requirement start in the
+        //       same month, the later of the two will find the earlier in its active list
+        bool nextIsSource = (reqPos == reqCount) ||
+            ((sourcePos < sourceCount) &&
+             (input.sources[sources[sourcePos]].startDate <=
+              input.requirements[requirements[reqPos]].startDate));
+        if(nextIsSource)
+        {
+            int srcIndex = sources[sourcePos++];
+            int startDate = input.sources[srcIndex].startDate;
+            int keptCount = 0;
+            for(int i=0; i<(int)activeRequirements.size(); i++)
+            {
+                int reqIndex = activeRequirements[i];
+                if(requirementEndDate(input, reqIndex) <= startDate)
+                    continue;
+                activeRequirements[keptCount++] = reqIndex;
+                handlePair(reqIndex, srcIndex);
+            }
+            activeRequirements.resize(keptCount);
+            activeSources.push_back(srcIndex);
+        }
+        else
+        {
+            int reqIndex = requirements[reqPos++];
+            int startDate = input.requirements[reqIndex].startDate;
+            int keptCount = 0;
+            for(int i=0; i<(int)activeSources.size(); i++)
+            {
+                int srcIndex = activeSources[i];
+                if(sourceEndDate(input, srcIndex) <= startDate)
+                    continue;
+                activeSources[keptCount++] = srcIndex;
+                handlePair(reqIndex, srcIndex);
+            }
+            activeSources.resize(keptCount);
+            activeRequirements.push_back(reqIndex);
+        }
+    }
+}
+
+// A source that could be allocated to a particular requirement, and how much it would save
+struct ScoredSource
+{
+    float saving;
+    int sourceIndex;
+};
+
+// Returns true iff a is a better candidate than b (with ties going to the lower source index, so
+// that the ranking never depends on the order in which the candidates were found)
+static bool isBetterCandidate(const ScoredSource& a, const ScoredSource& b)
+{
+    if(a.saving != b.saving)
+        return a.saving > b.saving;
+    return a.sourceIndex < b.sourceIndex;
+}
+
+// Finds the (at most) sourceLimits[reqIndex] best sources for every requirement, ranked by the
+// saving that allocating as much as possible from them would make, and returns them for each
+// requirement from best to worst.
+// NOTE: Each requirement's candidates are kept in a heap with the worst of them on top, so this
+//       only ever uses memory for the candidates that are kept
+static void collectBestSources(InputData& input, const vector<int>& sourceLimits,
+                               vector<vector<ScoredSource>>& bestSources)
+{
+    int reqCount = (int)input.requirements.size();
+    bestSources.assign(reqCount, vector<ScoredSource>());
+    parallelFor(TAX_CLASS_COUNT, [&](int taxClassIndex)
+    {
+        joinOverlapping(input, (TaxClass)taxClassIndex, [&](int reqIndex, int srcIndex)
+        {
+            int limit = sourceLimits[reqIndex];
+            if(limit <= 0)
+                return;
+
+            ScoredSource candidate;
+            candidate.saving = estimateSourceSaving(input.sources[srcIndex],
+                                                    input.requirements[reqIndex]);
+            candidate.sourceIndex = srcIndex;
+            vector<ScoredSource>& heap = bestSources[reqIndex];
+            if((int)heap.size() < limit)
+            {
+                heap.push_back(candidate);
+                push_heap(heap.begin(), heap.end(), isBetterCandidate);
+            }
+            else if(isBetterCandidate(candidate, heap.front()))
+            {
+                pop_heap(heap.begin(), heap.end(), isBetterCandidate);
+                heap.back() = candidate;
+                push_heap(heap.begin(), heap.end(), isBetterCandidate);
+            }
+        });
+    });
+
+    parallelFor(reqCount, [&](int reqIndex)
+    {
+        sort(bestSources[reqIndex].begin(), bestSources[reqIndex].end(), isBetterCandidate);
+    });
+}
+
+void enumerateAllocations(ProblemInstance& problem, int maxSourcesPerRequirement)
+{
+    InputData& input = problem.input;
+    int reqCount = (int)input.requirements.size();
+    int poolCount = (int)input.balancePools.size();
+
+    // NOTE: Every requirement has exactly one tax class, so the tax classes can be joined (and
+    //       their pairs written to the table below) in parallel without touching the same entries
+    vector<vector<OverlapPair>> taxClassPairs(TAX_CLASS_COUNT);
+    if(maxSourcesPerRequirement > 0)
+    {
+        vector<int> sourceLimits(reqCount, maxSourcesPerRequirement);
+        vector<vector<ScoredSource>> bestSources;
+        collectBestSources(input, sourceLimits, bestSources);
+        for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+        {
+            int taxClassIndex = (int)input.requirements[reqIndex].taxClass;
+            vector<OverlapPair>& pairs = taxClassPairs[taxClassIndex];
+            for(int i=0; i<(int)bestSources[reqIndex].size(); i++)
+            {
+                OverlapPair pair = {reqIndex, bestSources[reqIndex][i].sourceIndex};
+                pairs.push_back(pair);
+            }
+            vector<ScoredSource>().swap(bestSources[reqIndex]);
+        }
+    }
+    else
+    {
+        parallelFor(TAX_CLASS_COUNT, [&](int taxClassIndex)
+        {
+            vector<OverlapPair>& pairs = taxClassPairs[taxClassIndex];
+            joinOverlapping(input, (TaxClass)taxClassIndex, [&pairs](int reqIndex, int srcIndex)
+            {
+                OverlapPair pair = {reqIndex, srcIndex};
+                pairs.push_back(pair);
+            });
+        });
+    }
+
+    // Find where each requirement's slice of source allocations starts in the table
+    vector<int> requirementOffsets(reqCount + 1, 0);
+    requirementOffsets[0] = poolCount * reqCount;
+    for(int taxClassIndex=0; taxClassIndex<TAX_CLASS_COUNT; taxClassIndex++)
+    {
+        vector<OverlapPair>& pairs = taxClassPairs[taxClassIndex];
+        for(int i=0; i<(int)pairs.size(); i++)
+            requirementOffsets[pairs[i].requirementIndex + 1]++;
+    }
+    for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+        requirementOffsets[reqIndex + 1] += requirementOffsets[reqIndex];
+    int allocationCount = requirementOffsets[reqCount];
+
+    problem.allocations.resize(allocationCount);
+    AllocationPointer* allocations = problem.allocations.data();
+    memset(allocations, 0, allocationCount*sizeof(AllocationPointer));
+
+    int currentAllocIndex = 0;
+    for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+    {
+        for(int poolIndex=0; poolIndex<poolCount; poolIndex++)
+        {
+            allocations[currentAllocIndex].sourceIndex = -1;
+            allocations[currentAllocIndex].requirementIndex = reqIndex;
+            allocations[currentAllocIndex].balancePoolIndex = poolIndex;
+            currentAllocIndex++;
+        }
+    }
+
+    vector<int> nextAllocIndex(requirementOffsets.begin(), requirementOffsets.end() - 1);
+    parallelFor(TAX_CLASS_COUNT, [&](int taxClassIndex)
+    {
+        vector<OverlapPair>& pairs = taxClassPairs[taxClassIndex];
+        for(int i=0; i<(int)pairs.size(); i++)
+        {
+            AllocationPointer& alloc = allocations[nextAllocIndex[pairs[i].requirementIndex]++];
+            alloc.sourceIndex = pairs[i].sourceIndex;
+            alloc.requirementIndex = pairs[i].requirementIndex;
+            alloc.balancePoolIndex = -1;
+        }
+        vector<OverlapPair>().swap(pairs);
+    });
+
+    // NOTE: The sweep finds each requirement's sources in order of date rather than index
+    parallelFor(reqCount, [&](int reqIndex)
+    {
+        AllocationPointer* sliceStart = allocations + requirementOffsets[reqIndex];
+        AllocationPointer* sliceEnd = allocations + requirementOffsets[reqIndex+1];
+        sort(sliceStart, sliceEnd, [](const AllocationPointer& a, const AllocationPointer& b)
+        {
+            return a.sourceIndex < b.sourceIndex;
+        });
+    });
+
+    for(int allocIndex=0; allocIndex<allocationCount; allocIndex++)
+    {
+        allocations[allocIndex].allocStartDimension = allocIndex*DIMENSIONS_PER_ALLOCATION;
+    }
+}
+
+int expandCandidates(ProblemInstance& problem, Vector& solution, vector<int>& sourceLimits)
+{
+    InputData& input = problem.input;
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    // Find every requirement that relies on the RCF or a balance pool in at least one month
+    // NOTE: Balance pools cost more than most sources, so we also look for more sources to replace
+    //       them with
+    int reqCount = (int)input.requirements.size();
+    vector<int> coverOffset(reqCount + 1, 0);
+    for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+    {
+        int tenor = max(input.requirements[reqIndex].tenor, 0);
+        coverOffset[reqIndex + 1] = coverOffset[reqIndex] + tenor;
+    }
+    vector<float> cover(coverOffset[reqCount], 0.0f);
+    for(int allocIndex=0; allocIndex<allocationCount; allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        float amount = alloc.getAmount(solution);
+        int startDate = (int)(alloc.getStartDate(solution) + 0.5f);
+        int tenor = (int)(alloc.getTenor(solution) + 0.5f);
+        if((alloc.sourceIndex < 0) || (tenor <= 0) || (amount <= 0.0f))
+            continue;
+
+        RequirementInfo& req = input.requirements[alloc.requirementIndex];
+        int fromMonth = max(startDate, req.startDate);
+        int toMonth = min(startDate + tenor, req.startDate + req.tenor);
+        for(int month=fromMonth; month<toMonth; month++)
+            cover[coverOffset[alloc.requirementIndex] + month - req.startDate] += amount;
+    }
+
+    vector<int> newLimits(reqCount, 0);
+    bool anyUnderserved = false;
+    for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+    {
+        if(sourceLimits[reqIndex] == INT_MAX)
+            continue; // We already have every source that overlaps this requirement
+
+        float minCover = FLT_MAX;
+        for(int i=coverOffset[reqIndex]; i<coverOffset[reqIndex+1]; i++)
+            minCover = min(minCover, cover[i]);
+        if(minCover < (float)input.requirements[reqIndex].amount - 0.5f)
+        {
+            newLimits[reqIndex] = (sourceLimits[reqIndex] > INT_MAX/2) ? INT_MAX :
+                                                                          2*sourceLimits[reqIndex];
+            anyUnderserved = true;
+        }
+    }
+    if(!anyUnderserved)
+        return 0;
+
+    // NOTE: The ranking is deterministic, so every requirement's best sources start with exactly
+    //       the ones that it already has
+    vector<vector<ScoredSource>> bestSources;
+    collectBestSources(input, newLimits, bestSources);
+    vector<AllocationPointer> newAllocations;
+    for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+    {
+        if(newLimits[reqIndex] <= 0)
+            continue;
+
+        vector<ScoredSource>& best = bestSources[reqIndex];
+        for(int i=sourceLimits[reqIndex]; i<(int)best.size(); i++)
+        {
+            AllocationPointer alloc;
+            memset(&alloc, 0, sizeof(AllocationPointer));
+            alloc.sourceIndex = best[i].sourceIndex;
+            alloc.requirementIndex = reqIndex;
+            alloc.balancePoolIndex = -1;
+            newAllocations.push_back(alloc);
+        }
+        sourceLimits[reqIndex] = ((int)best.size() < newLimits[reqIndex]) ? INT_MAX :
+                                                                           newLimits[reqIndex];
+    }
+    if(newAllocations.empty())
+        return 0;
+
+    problem.allocations.insert(problem.allocations.end(),
+                               newAllocations.begin(), newAllocations.end());
+    int newCount = (int)problem.allocations.size();
+
+    Vector expandedSolution(newCount * DIMENSIONS_PER_ALLOCATION);
+    memcpy(expandedSolution.coords, solution.coords, solution.dimensions*sizeof(float));
+    for(int allocIndex=allocationCount; allocIndex<newCount; allocIndex++)
+    {
+        AllocationPointer& alloc = problem.allocations[allocIndex];
+        alloc.allocStartDimension = allocIndex*DIMENSIONS_PER_ALLOCATION;
+        alloc.setStartDate(expandedSolution, alloc.getMinStartDate(input));
+        alloc.setTenor(expandedSolution, 0.0f);
+        alloc.setAmount(expandedSolution, 0.0f);
+    }
+
+    solution = expandedSolution;
+    return newCount - allocationCount;
+}
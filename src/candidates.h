@@ -0,0 +1,31 @@
+#ifndef _CANDIDATES_H
+#define _CANDIDATES_H
+
+#include <vector>
+
+#include "fundmatch.h"
+
+// The number of times that main adds more candidates for under-served requirements, when only the
+// best few sources of each requirement are used as candidates
+const int MAX_CANDIDATE_EXPANSIONS = 4;
+
+// Fills the problem's allocation table with every candidate allocation for its input.
+// The table starts with an allocation from every balance pool to every requirement, in order of
+// requirement and then balance pool. After that comes an allocation for every source and
+// requirement of the same tax class that overlap by at least a month, in order of requirement and
+// then source.
+// If maxSourcesPerRequirement is greater than 0 then only that many sources are used for each
+// requirement, namely those that would save the most (see estimateSourceSaving), and only
+// O(requirements*maxSourcesPerRequirement) memory is used to find them.
+void enumerateAllocations(ProblemInstance& problem, int maxSourcesPerRequirement=0);
+
+// Adds more candidate sources for every requirement that the given solution leaves under-served
+// (IE that relies on the RCF or a balance pool in at least one month), when it has more
+// overlapping sources than the sourceLimits[reqIndex] best that it already has. Each such
+// requirement's limit is doubled, or set to INT_MAX once it has every source.
+// The new allocations are appended to the problem's table, and the solution is extended to match
+// with every new allocation left empty.
+// Returns the number of allocations that were added.
+int expandCandidates(ProblemInstance& problem, Vector& solution, std::vector<int>& sourceLimits);
+
+#endif // _CANDIDATES_H
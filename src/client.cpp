@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "Jzon.h"
+#include "readfile.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+using namespace std;
+
+// A minimal client for the solver daemon (see daemon.h), which sends it a single job and writes
+// the solution that it sends back to a file.
+// Usage: client <socket path> [options] [dataset]
+//   --inline         Send the contents of the dataset's CSV files rather than just its name
+//   --solver <name>, --seed <n>, --gap-target <g>, --deadline <s>, --top-k <k>, --horizon <m>
+//                    Passed on to the daemon as part of the job
+//   --previous <file>
+//                    An earlier output.json for the daemon to re-optimize from incrementally
+//   --warm-start <file>
+//                    An earlier output.json or allocations CSV for the daemon to start from
+//   --output <file>  Where to write the solution (output.json by default)
+//   --shutdown       Ask the daemon to shut down rather than solve anything
+
+int main(int argc, char** argv)
+{
+#ifdef _WIN32
+    printf("Error: The daemon client is only supported on Unix\n");
+    return -1;
+#else
+    if(argc < 2)
+    {
+        printf("Usage: %s <socket path> [options] [dataset]\n", argv[0]);
+        return -1;
+    }
+    const char* socketPath = argv[1];
+    const char* outputFilename = "output.json";
+    const char* dataName = "DS1";
+    bool sendInline = false;
+
+    Jzon::Node request = Jzon::object();
+    for(int argIndex=2; argIndex<argc; argIndex++)
+    {
+        const char* arg = argv[argIndex];
+        bool hasValue = (argIndex+1 < argc);
+        if(strcmp(arg, "--inline") == 0)
+        {
+            sendInline = true;
+        }
+        else if(strcmp(arg, "--shutdown") == 0)
+        {
+            request.add("command", "shutdown");
+        }
+        else if((strcmp(arg, "--output") == 0) && hasValue)
+        {
+            outputFilename = argv[++argIndex];
+        }
+        else if((strcmp(arg, "--solver") == 0) && hasValue)
+        {
+            request.add("solver", argv[++argIndex]);
+        }
+        else if((strcmp(arg, "--seed") == 0) && hasValue)
+        {
+            request.add("seed", Jzon::Node(Jzon::Node::T_NUMBER, argv[++argIndex]));
+        }
+        else if((strcmp(arg, "--gap-target") == 0) && hasValue)
+        {
+            request.add("gapTarget", atof(argv[++argIndex]));
+        }
+        else if((strcmp(arg, "--deadline") == 0) && hasValue)
+        {
+            request.add("deadline", atof(argv[++argIndex]));
+        }
+        else if((strcmp(arg, "--top-k") == 0) && hasValue)
+        {
+            request.add("topK", atoi(argv[++argIndex]));
+        }
+        else if((strcmp(arg, "--horizon") == 0) && hasValue)
+        {
+            request.add("horizon", atoi(argv[++argIndex]));
+        }
+        else if((strcmp(arg, "--previous") == 0) && hasValue)
+        {
+            request.add("previous", argv[++argIndex]);
+        }
+        else if((strcmp(arg, "--warm-start") == 0) && hasValue)
+        {
+            request.add("warmStart", argv[++argIndex]);
+        }
+        else if(arg[0] == '-')
+        {
+            printf("Error: Unrecognized option %s\n", arg);
+            return -1;
+        }
+        else
+        {
+            dataName = arg;
+        }
+    }
+
+    if(sendInline)
+    {
+        const char* fileSuffixes[] = {"_sources.csv", "_balancepools.csv", "_requirements.csv"};
+        const char* fieldNames[] = {"sources", "balancePools", "requirements"};
+        for(int i=0; i<3; i++)
+        {
+            string filename = string("data/") + dataName + fileSuffixes[i];
+            string contents;
+            if(!readFile(filename, contents))
+            {
+                printf("Error: Unable to read %s\n", filename.c_str());
+                return -1;
+            }
+            request.add(fieldNames[i], Jzon::Node(Jzon::Node::T_STRING, contents));
+        }
+    }
+    else
+    {
+        request.add("dataset", dataName);
+    }
+
+    string requestJson;
+    Jzon::Writer writer;
+    writer.writeString(request, requestJson);
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        printf("Error: Socket path %s is too long\n", socketPath);
+        return -1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if((connection < 0) || (connect(connection, (sockaddr*)&address, sizeof(address)) != 0))
+    {
+        printf("Error: Unable to connect to %s (%s)\n", socketPath, strerror(errno));
+        return -1;
+    }
+
+    // NOTE: Shutting down our side of the connection is what tells the daemon that the request
+    //       is complete
+    size_t written = 0;
+    while(written < requestJson.size())
+    {
+        ssize_t writeCount = send(connection, requestJson.data() + written,
+                                  requestJson.size() - written, 0);
+        if(writeCount < 0)
+        {
+            printf("Error: Unable to send the request (%s)\n", strerror(errno));
+            close(connection);
+            return -1;
+        }
+        written += (size_t)writeCount;
+    }
+    shutdown(connection, SHUT_WR);
+
+    string response;
+    char buffer[65536];
+    ssize_t readCount;
+    while((readCount = recv(connection, buffer, sizeof(buffer), 0)) > 0)
+        response.append(buffer, (size_t)readCount);
+    close(connection);
+
+    size_t statusEnd = response.find('\n');
+    if(statusEnd == string::npos)
+    {
+        printf("Error: The daemon closed the connection without replying\n");
+        return -1;
+    }
+    printf("%s\n", response.substr(0, statusEnd).c_str());
+    if(response.compare(0, 2, "OK") != 0)
+        return -1;
+
+    if(statusEnd+1 < response.size())
+    {
+        FILE* outFile = fopen(outputFilename, "wb");
+        if(!outFile)
+        {
+            printf("Error: Unable to write the solution to %s\n", outputFilename);
+            return -1;
+        }
+        fwrite(response.data() + statusEnd + 1, 1, response.size() - statusEnd - 1, outFile);
+        fclose(outFile);
+    }
+    return 0;
+#endif
+}
@@ -1,159 +1,458 @@
-#ifndef _CSV_READER_H
-#define _CSV_READER_H
-
-#include <stdio.h>
-
-const int MAX_CSV_FIELD_SIZE = 1023;
-
-class CsvReader
-{
-public:
-    CsvReader();
-    ~CsvReader();
-
-    int entryCount();
-    int fieldCount();
-    bool initialize(const char* filename);
-    bool readNextEntry();
-    char* field(int index);
-    int fieldLength(int index);
-    void copyFieldStr(int index, char** targetStr); // NOTE: Allocates the right amount of space and copies the field into it
-
-private:
-    FILE* fileHandle;
-    char** fieldValues;
-    int* fieldValueLengths;
-    int _fieldCount;
-    int _entryCount;
-};
-
-#ifdef CSV_READER_IMPLEMENTATION
-#include <string.h>
-
-// TODO: Handle escaped commas (or commas inside quotes, whatever)
-CsvReader::CsvReader() :
-    fileHandle(NULL), fieldValues(NULL), fieldValueLengths(0),
-    _fieldCount(0), _entryCount(0) {}
-
-CsvReader::~CsvReader()
-{
-    if(fileHandle != NULL)
-    {
-        fclose(fileHandle);
-        fileHandle = NULL;
-    }
-    if(fieldValues != NULL)
-    {
-        for(int i=0; i<_fieldCount; i++)
-        {
-            delete[] fieldValues[i];
-        }
-        delete[] fieldValues;
-        fieldValues = 0;
-
-        delete[] fieldValueLengths;
-        fieldValueLengths = 0;
-    }
-}
-
-int CsvReader::entryCount()
-{
-    return _entryCount;
-}
-
-int CsvReader::fieldCount()
-{
-    return _fieldCount;
-}
-
-bool CsvReader::initialize(const char* filename)
-{
-    fileHandle = fopen(filename, "r");
-    if(!fileHandle)
-        return false;
-
-    char c;
-    int fileEntryCount = 0;
-    while((c = (char)fgetc(fileHandle)) != EOF)
-    {
-        if(c == '\n')
-            fileEntryCount++;
-    }
-    _entryCount = fileEntryCount - 1; // Ignore headings
-    rewind(fileHandle);
-
-    // Fast-forward past the first (heading) row, counting fields as we go
-    int entryCommaCount = 0;
-    while((c = (char)fgetc(fileHandle)) != '\n')
-    {
-        if(c == ',')
-            entryCommaCount++;
-    }
-    _fieldCount = entryCommaCount + 1; // We don't have a comma at the end of the line
-    fieldValueLengths = new int[_fieldCount];
-    fieldValues = new char*[_fieldCount];
-    for(int i=0; i<_fieldCount; i++)
-    {
-        fieldValues[i] = new char[MAX_CSV_FIELD_SIZE+1]; // For the trailing 0
-        memset(fieldValues[i], 0, MAX_CSV_FIELD_SIZE+1);
-    }
-
-    // TODO: Read the headings into some or other buffer
-    return true;
-}
-
-bool CsvReader::readNextEntry()
-{
-    int fieldIndex = 0;
-    int fieldCharIndex = 0;
-    memset(fieldValueLengths, 0, _fieldCount*sizeof(int));
-
-    char c;
-    while((c = (char)fgetc(fileHandle)) != '\n')
-    {
-        if(c == '\r')
-            continue;
-
-        if(c == ',')
-        {
-            fieldValueLengths[fieldIndex] = fieldCharIndex;
-            fieldValues[fieldIndex][fieldCharIndex] = 0;
-            fieldCharIndex = 0;
-            fieldIndex++;
-        }
-        else
-        {
-            if(fieldCharIndex == MAX_CSV_FIELD_SIZE)
-            {
-                fprintf(stderr, "ERROR: Field string is too long: %s at index %d\n",
-                        fieldValues[fieldIndex], fieldIndex);
-                return false;
-            }
-            fieldValues[fieldIndex][fieldCharIndex++] = c;
-        }
-    }
-    fieldValues[fieldIndex][fieldCharIndex] = 0; // Null-terminate the last field's string
-    return true;
-}
-
-char* CsvReader::field(int index)
-{
-    return fieldValues[index];
-}
-
-int CsvReader::fieldLength(int index)
-{
-    return fieldValueLengths[index];
-}
-
-void CsvReader::copyFieldStr(int index, char** targetStr)
-{
-    char* strBuffer = new char[fieldLength(index) + 1];
-    strcpy(strBuffer, field(index));
-
-    *targetStr = strBuffer;
-}
-
-#endif // CSV_READER_IMPLEMENTATION
-
-#endif // _CSV_READER_H
+#ifndef _CSV_READER_H
+#define _CSV_READER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Strings that are copied out of a CSV file are packed into blocks of (at least) this many bytes
+const int CSV_STRING_BLOCK_SIZE = 64*1024;
+
+// Reads a CSV file (or CSV text that is already in memory) one entry at a time.
+// NOTE: Files are memory-mapped rather than read, and the fields of each entry are views straight
+//       into the file's contents, so nothing is copied unless it is asked for with copyFieldStr.
+//       Fields are therefore NOT null-terminated, and are only valid until the next entry is read.
+class CsvReader
+{
+public:
+    CsvReader();
+    ~CsvReader();
+
+    int entryCount();
+    int fieldCount();
+    bool initialize(const char* filename);
+    bool initialize(const char* text, size_t length); // NOTE: The text must outlive the reader
+    bool readNextEntry(); // Returns false if there are no entries left or the entry is malformed
+
+    const char* field(int index);
+    int fieldLength(int index);
+    int fieldInt(int index); // Parses the field in the same way as atoi
+    float fieldFloat(int index); // Parses the field in the same way as atof
+    // Parses a field of the form day/month/year (any single non-digit can separate them)
+    // Returns false (and zeroes the values) if the field doesn't contain 3 numbers
+    bool fieldDate(int index, int& day, int& month, int& year);
+
+    // NOTE: Allocates the right amount of space from the reader's string blocks and copies the
+    //       field into it, with a null-terminator. The strings are freed along with the reader
+    //       unless their blocks are taken with takeStrings.
+    void copyFieldStr(int index, char** targetStr);
+    // Moves the blocks that hold every string copied so far onto the end of the given list, after
+    // which the caller is responsible for freeing them (with delete[])
+    void takeStrings(std::vector<char*>& stringBlocks);
+
+private:
+    bool readHeadings();
+    void unmapFile();
+
+    const char* data;
+    const char* dataEnd;
+    const char* cursor; // The start of the next entry
+    bool ownsMapping;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+
+    const char** fieldValues;
+    int* fieldValueLengths;
+    int _fieldCount;
+    int _entryCount;
+
+    std::vector<char*> stringBlocks;
+    int stringBlockRemaining; // The number of unused bytes at the end of the last string block
+};
+
+#ifdef CSV_READER_IMPLEMENTATION
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Numbers with more characters than this are never valid, so they are cut short
+const int MAX_CSV_NUMBER_LENGTH = 63;
+
+// Exact powers of 10, with which any decimal of up to 15 significant digits can be converted
+// to the nearest double with a single (correctly rounded) division
+static const double CSV_POWERS_OF_10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int MAX_EXACT_CSV_DIGITS = 15;
+
+static inline bool isCsvDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static inline bool isCsvSpace(char c)
+{
+    return (c == ' ') || (c == '\t');
+}
+
+// TODO: Handle escaped commas (or commas inside quotes, whatever)
+CsvReader::CsvReader() :
+    data(NULL), dataEnd(NULL), cursor(NULL), ownsMapping(false),
+#ifdef _WIN32
+    fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL),
+#endif
+    fieldValues(NULL), fieldValueLengths(NULL),
+    _fieldCount(0), _entryCount(0), stringBlockRemaining(0) {}
+
+CsvReader::~CsvReader()
+{
+    unmapFile();
+    delete[] fieldValues;
+    fieldValues = NULL;
+    delete[] fieldValueLengths;
+    fieldValueLengths = NULL;
+
+    for(int i=0; i<(int)stringBlocks.size(); i++)
+        delete[] stringBlocks[i];
+}
+
+void CsvReader::unmapFile()
+{
+    if(!ownsMapping)
+        return;
+#ifdef _WIN32
+    if(mappingHandle != NULL)
+        UnmapViewOfFile(data);
+    if(mappingHandle != NULL)
+        CloseHandle(mappingHandle);
+    if(fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+    mappingHandle = NULL;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if(data != NULL)
+        munmap((void*)data, (size_t)(dataEnd - data));
+#endif
+    data = NULL;
+    dataEnd = NULL;
+    ownsMapping = false;
+}
+
+int CsvReader::entryCount()
+{
+    return _entryCount;
+}
+
+int CsvReader::fieldCount()
+{
+    return _fieldCount;
+}
+
+bool CsvReader::initialize(const char* filename)
+{
+    // NOTE: An empty file can't be mapped, so it is treated as empty text instead
+    size_t length = 0;
+#ifdef _WIN32
+    fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER fileSize;
+    if((fileHandle == INVALID_HANDLE_VALUE) || !GetFileSizeEx(fileHandle, &fileSize))
+    {
+        if(fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    ownsMapping = true;
+    length = (size_t)fileSize.QuadPart;
+    if(length > 0)
+    {
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mappingHandle != NULL)
+            data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if(data == NULL)
+        {
+            unmapFile();
+            return false;
+        }
+    }
+#else
+    int fileDescriptor = open(filename, O_RDONLY);
+    if(fileDescriptor < 0)
+        return false;
+    struct stat fileInfo;
+    if(fstat(fileDescriptor, &fileInfo) != 0)
+    {
+        close(fileDescriptor);
+        return false;
+    }
+    length = (size_t)fileInfo.st_size;
+    if(length > 0)
+    {
+        void* mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if(mapping == MAP_FAILED)
+        {
+            close(fileDescriptor);
+            return false;
+        }
+        // NOTE: We only ever read straight through the file, once to count the entries and then
+        //       once to read them
+        madvise(mapping, length, MADV_SEQUENTIAL);
+        data = (const char*)mapping;
+        ownsMapping = true;
+    }
+    // NOTE: The mapping stays valid after the file is closed
+    close(fileDescriptor);
+#endif
+    if(data == NULL)
+        data = "";
+    dataEnd = data + length;
+    return readHeadings();
+}
+
+bool CsvReader::initialize(const char* text, size_t length)
+{
+    data = text;
+    dataEnd = text + length;
+    return readHeadings();
+}
+
+bool CsvReader::readHeadings()
+{
+    // NOTE: memchr is vectorized by every C library that we build against, so this is limited by
+    //       how fast the file can be read rather than by looking at each character in turn
+    int lineCount = 0;
+    const char* lineStart = data;
+    while(lineStart < dataEnd)
+    {
+        const char* lineEnd = (const char*)memchr(lineStart, '\n', (size_t)(dataEnd - lineStart));
+        lineCount++;
+        if(lineEnd == NULL)
+            break;
+        lineStart = lineEnd + 1;
+    }
+    _entryCount = lineCount - 1; // Ignore headings
+
+    // Skip past the first (heading) row, counting fields as we go
+    const char* headingEnd = (const char*)memchr(data, '\n', (size_t)(dataEnd - data));
+    if(headingEnd == NULL)
+        headingEnd = dataEnd;
+    int entryCommaCount = 0;
+    const char* comma = data;
+    while((comma = (const char*)memchr(comma, ',', (size_t)(headingEnd - comma))) != NULL)
+    {
+        entryCommaCount++;
+        comma++;
+    }
+    cursor = (headingEnd < dataEnd) ? headingEnd + 1 : dataEnd;
+
+    _fieldCount = entryCommaCount + 1; // We don't have a comma at the end of the line
+    fieldValueLengths = new int[_fieldCount];
+    fieldValues = new const char*[_fieldCount];
+    for(int i=0; i<_fieldCount; i++)
+    {
+        fieldValues[i] = dataEnd;
+        fieldValueLengths[i] = 0;
+    }
+
+    // TODO: Read the headings into some or other buffer
+    return true;
+}
+
+bool CsvReader::readNextEntry()
+{
+    for(int i=0; i<_fieldCount; i++)
+    {
+        fieldValues[i] = dataEnd;
+        fieldValueLengths[i] = 0;
+    }
+    if(cursor >= dataEnd)
+        return false;
+
+    const char* lineEnd = (const char*)memchr(cursor, '\n', (size_t)(dataEnd - cursor));
+    const char* nextCursor = dataEnd;
+    if(lineEnd == NULL)
+        lineEnd = dataEnd;
+    else
+        nextCursor = lineEnd + 1;
+    if((lineEnd > cursor) && (lineEnd[-1] == '\r'))
+        lineEnd--;
+
+    const char* fieldStart = cursor;
+    cursor = nextCursor;
+    for(int fieldIndex=0; ; fieldIndex++)
+    {
+        const char* fieldEnd = (const char*)memchr(fieldStart, ',', (size_t)(lineEnd - fieldStart));
+        if(fieldEnd == NULL)
+            fieldEnd = lineEnd;
+        fieldValues[fieldIndex] = fieldStart;
+        fieldValueLengths[fieldIndex] = (int)(fieldEnd - fieldStart);
+        if(fieldEnd == lineEnd)
+            break;
+
+        if(fieldIndex+1 == _fieldCount)
+        {
+            fprintf(stderr, "ERROR: Entry has more than %d fields\n", _fieldCount);
+            return false;
+        }
+        fieldStart = fieldEnd + 1;
+    }
+    return true;
+}
+
+const char* CsvReader::field(int index)
+{
+    return fieldValues[index];
+}
+
+int CsvReader::fieldLength(int index)
+{
+    return fieldValueLengths[index];
+}
+
+int CsvReader::fieldInt(int index)
+{
+    const char* text = fieldValues[index];
+    const char* end = text + fieldValueLengths[index];
+    while((text < end) && isCsvSpace(*text))
+        text++;
+
+    bool negative = false;
+    if((text < end) && ((*text == '-') || (*text == '+')))
+    {
+        negative = (*text == '-');
+        text++;
+    }
+    int value = 0;
+    while((text < end) && isCsvDigit(*text))
+    {
+        value = 10*value + (*text - '0');
+        text++;
+    }
+    return negative ? -value : value;
+}
+
+float CsvReader::fieldFloat(int index)
+{
+    const char* text = fieldValues[index];
+    const char* end = text + fieldValueLengths[index];
+    while((text < end) && isCsvSpace(*text))
+        text++;
+
+    // NOTE: Plain decimals with few enough digits (which is all of them in practice) are converted
+    //       exactly here, anything else goes through strtod
+    const char* numberStart = text;
+    bool negative = false;
+    if((text < end) && ((*text == '-') || (*text == '+')))
+    {
+        negative = (*text == '-');
+        text++;
+    }
+    uint64_t mantissa = 0;
+    int digitCount = 0;
+    int fractionDigitCount = 0;
+    bool inFraction = false;
+    for(; text < end; text++)
+    {
+        if(isCsvDigit(*text))
+        {
+            mantissa = 10*mantissa + (uint64_t)(*text - '0');
+            digitCount++;
+            if(inFraction)
+                fractionDigitCount++;
+        }
+        else if((*text == '.') && !inFraction)
+        {
+            inFraction = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    bool hasExponent = (text < end) && ((*text == 'e') || (*text == 'E'));
+    if((digitCount <= MAX_EXACT_CSV_DIGITS) && !hasExponent)
+    {
+        double value = (double)mantissa / CSV_POWERS_OF_10[fractionDigitCount];
+        return (float)(negative ? -value : value);
+    }
+
+    char numberText[MAX_CSV_NUMBER_LENGTH+1];
+    int numberLength = (int)(end - numberStart);
+    if(numberLength > MAX_CSV_NUMBER_LENGTH)
+        numberLength = MAX_CSV_NUMBER_LENGTH;
+    memcpy(numberText, numberStart, numberLength);
+    numberText[numberLength] = 0;
+    return (float)strtod(numberText, NULL);
+}
+
+bool CsvReader::fieldDate(int index, int& day, int& month, int& year)
+{
+    const char* text = fieldValues[index];
+    const char* end = text + fieldValueLengths[index];
+    int* parts[3] = {&day, &month, &year};
+    for(int partIndex=0; partIndex<3; partIndex++)
+    {
+        if(partIndex > 0)
+            text++; // Skip the separator
+        if((text >= end) || !isCsvDigit(*text))
+        {
+            day = month = year = 0;
+            return false;
+        }
+
+        int value = 0;
+        while((text < end) && isCsvDigit(*text))
+        {
+            value = 10*value + (*text - '0');
+            text++;
+        }
+        *parts[partIndex] = value;
+    }
+    return true;
+}
+
+void CsvReader::copyFieldStr(int index, char** targetStr)
+{
+    int length = fieldValueLengths[index];
+    char* strBuffer;
+    if(length+1 > CSV_STRING_BLOCK_SIZE)
+    {
+        // NOTE: A string that needs a block of its own goes before the last block, so that the
+        //       rest of the last block can still be used
+        strBuffer = new char[length+1];
+        stringBlocks.insert(stringBlocks.end() - (stringBlocks.empty() ? 0 : 1), strBuffer);
+    }
+    else
+    {
+        if(length+1 > stringBlockRemaining)
+        {
+            stringBlocks.push_back(new char[CSV_STRING_BLOCK_SIZE]);
+            stringBlockRemaining = CSV_STRING_BLOCK_SIZE;
+        }
+        strBuffer = stringBlocks.back() + (CSV_STRING_BLOCK_SIZE - stringBlockRemaining);
+        stringBlockRemaining -= length+1;
+    }
+    memcpy(strBuffer, fieldValues[index], length);
+    strBuffer[length] = 0;
+
+    *targetStr = strBuffer;
+}
+
+void CsvReader::takeStrings(std::vector<char*>& targetBlocks)
+{
+    targetBlocks.insert(targetBlocks.end(), stringBlocks.begin(), stringBlocks.end());
+    stringBlocks.clear();
+    stringBlockRemaining = 0;
+}
+
+#endif // CSV_READER_IMPLEMENTATION
+
+#endif // _CSV_READER_H
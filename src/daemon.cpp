@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <sstream>
+#include <utility>
+
+#include "daemon.h"
+#include "fundmatch.h"
+#include "bounds.h"
+#include "dataio.h"
+#include "pipeline.h"
+#include "readfile.h"
+#include "timing.h"
+#include "sha256.h"
+#include "Jzon.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+using namespace std;
+
+const int MAX_STATUS_LENGTH = 256;
+
+struct CachedProblem
+{
+    ProblemInstance problem;
+    uint64_t lastUsed; // The job number that last used this problem
+};
+
+struct DaemonState
+{
+    RunOptions defaultOptions;
+    float defaultTimeLimit;
+    map<Sha256Digest, CachedProblem> cache;
+    uint64_t jobCount;
+};
+
+// Adds the given text to the hash, after its length so that moving text from the end of one
+// string to the start of the next changes the digest
+static void hashString(Sha256& hash, const string& text)
+{
+    uint64_t length = (uint64_t)text.size();
+    hash.add(&length, sizeof(length));
+    hash.add(text.data(), text.size());
+}
+
+static string errorResponse(const string& message)
+{
+    printf("Job failed: %s\n", message.c_str());
+    return "ERROR " + message + "\n";
+}
+
+// Finds (or parses and prepares) the problem for the given CSV contents and options
+// Returns nullptr if the contents couldn't be parsed
+static CachedProblem* findProblem(DaemonState& state, const string& sourceText,
+                                  const string& balancePoolText, const string& requirementText,
+                                  const RunOptions& options, bool& wasCached)
+{
+    // NOTE: Only the allocation table depends on the options (through topK), the lower bound is
+    //       the same no matter what the solver is asked to do
+    Sha256 hash;
+    hashString(hash, sourceText);
+    hashString(hash, balancePoolText);
+    hashString(hash, requirementText);
+    hash.add(&options.topK, sizeof(options.topK));
+    Sha256Digest key = hash.finish();
+
+    map<Sha256Digest, CachedProblem>::iterator cacheIt = state.cache.find(key);
+    wasCached = (cacheIt != state.cache.end());
+    if(!wasCached)
+    {
+        CachedProblem entry;
+        entry.problem.options = options;
+        InputData& input = entry.problem.input;
+        if(!parseSourceData(sourceText.data(), sourceText.size(), input) ||
+           !parseBalancePoolData(balancePoolText.data(), balancePoolText.size(), input) ||
+           !parseRequirementData(requirementText.data(), requirementText.size(), input))
+        {
+            freeInputStrings(input);
+            return nullptr;
+        }
+        printf("Parsed %zd sources, %zd balance pools and %zd requirements\n",
+               input.sources.size(), input.balancePools.size(), input.requirements.size());
+        prepareProblem(entry.problem);
+
+        if((int)state.cache.size() >= MAX_CACHED_PROBLEMS)
+        {
+            map<Sha256Digest, CachedProblem>::iterator oldestIt = state.cache.begin();
+            for(cacheIt=state.cache.begin(); cacheIt!=state.cache.end(); cacheIt++)
+            {
+                if(cacheIt->second.lastUsed < oldestIt->second.lastUsed)
+                    oldestIt = cacheIt;
+            }
+            freeInputStrings(oldestIt->second.problem.input);
+            state.cache.erase(oldestIt);
+        }
+        cacheIt = state.cache.insert(make_pair(key, std::move(entry))).first;
+    }
+    cacheIt->second.lastUsed = state.jobCount;
+    return &cacheIt->second;
+}
+
+// Handles a single request and puts the reply to it in response.
+// Returns false iff the daemon should shut down.
+static bool handleRequest(DaemonState& state, const string& request, string& response)
+{
+    state.jobCount++;
+    Jzon::Parser parser;
+    Jzon::Node root = parser.parseString(request);
+    if(!root.isObject())
+    {
+        response = errorResponse("Invalid request: " + parser.getError());
+        return true;
+    }
+
+    string command = root.get("command").toString("solve");
+    if(command == "shutdown")
+    {
+        response = "OK shutting down\n";
+        return false;
+    }
+    if(command != "solve")
+    {
+        response = errorResponse("Unrecognized command " + command);
+        return true;
+    }
+    string solver = root.get("solver").toString(SOLVER_NAME);
+    if(solver != SOLVER_NAME)
+    {
+        response = errorResponse(string("This daemon only runs the ") + SOLVER_NAME + " solver");
+        return true;
+    }
+
+    RunOptions options = state.defaultOptions;
+    if(root.has("seed"))
+        options.seed = strtoull(root.get("seed").toString().c_str(), nullptr, 10);
+    options.gapTarget = root.get("gapTarget").toFloat(options.gapTarget);
+    options.topK = root.get("topK").toInt(options.topK);
+    options.horizonMonths = root.get("horizon").toInt(options.horizonMonths);
+    float timeLimit = root.get("deadline").toFloat(state.defaultTimeLimit);
+
+    string sourceText;
+    string balancePoolText;
+    string requirementText;
+    if(root.has("dataset"))
+    {
+        string dataName = root.get("dataset").toString();
+        string prefix = "data/" + dataName;
+        if(!readFile(prefix + "_sources.csv", sourceText) ||
+           !readFile(prefix + "_balancepools.csv", balancePoolText) ||
+           !readFile(prefix + "_requirements.csv", requirementText))
+        {
+            response = errorResponse("Unable to read the files for dataset " + dataName);
+            return true;
+        }
+    }
+    else
+    {
+        sourceText = root.get("sources").toString();
+        balancePoolText = root.get("balancePools").toString();
+        requirementText = root.get("requirements").toString();
+    }
+
+    // NOTE: The previous solution is loaded before anything else, so that a bad path fails fast
+    ProblemInstance previous;
+    Vector previousSolution;
+    if(root.has("previous"))
+    {
+        string previousFilename = root.get("previous").toString();
+        previousSolution = loadOutputData(previousFilename.c_str(), previous.input,
+                                          previous.allocations);
+        if(previousSolution.dimensions == 0)
+        {
+            freeInputStrings(previous.input);
+            response = errorResponse("Unable to load a previous solution from " +
+                                     previousFilename);
+            return true;
+        }
+    }
+
+    double startTime = steadyClockSeconds();
+    bool wasCached = false;
+    CachedProblem* cached = findProblem(state, sourceText, balancePoolText, requirementText,
+                                        options, wasCached);
+    if(cached == nullptr)
+    {
+        freeInputStrings(previous.input);
+        response = errorResponse("Unable to parse the input data");
+        return true;
+    }
+
+    ProblemInstance problem = cached->problem;
+    problem.options = options;
+    if(timeLimit > 0.0f)
+        problem.options.deadline = startTime + timeLimit;
+    if(root.has("warmStart"))
+    {
+        string warmStartFilename = root.get("warmStart").toString();
+        if(!loadWarmStart(warmStartFilename.c_str(), problem))
+        {
+            freeInputStrings(previous.input);
+            response = errorResponse("Unable to warm start from " + warmStartFilename);
+            return true;
+        }
+    }
+
+    Vector solution;
+    if(previousSolution.dimensions > 0)
+        solution = solveProblemIncrementally(problem, previous, previousSolution);
+    else
+        solution = solveProblem(problem);
+    freeInputStrings(previous.input);
+    float solutionFitness = -1.0f;
+    float gap = -1.0f;
+    if(isFeasible(solution, problem))
+    {
+        solutionFitness = computeFitness(solution, problem);
+        if(hasLowerBound(problem))
+            gap = computeOptimalityGap(problem, solutionFitness);
+    }
+    float seconds = (float)(steadyClockSeconds() - startTime);
+
+    ostringstream solutionJson;
+    int generatedAllocs = writeOutputData(problem, solution, solutionJson);
+
+    char status[MAX_STATUS_LENGTH];
+    snprintf(status, MAX_STATUS_LENGTH,
+             "OK fitness=%.2f allocations=%d gap=%.2f seconds=%.2f cached=%d\n",
+             solutionFitness, generatedAllocs, gap, seconds, wasCached ? 1 : 0);
+    printf("Job %llu: %s", (unsigned long long)state.jobCount, status + 3);
+    response = status + solutionJson.str();
+    return true;
+}
+
+#ifndef _WIN32
+// Reads a whole request, until the client shuts down its side of the connection.
+// Returns false (and puts the reason in error) if the client sends too much or stops sending.
+static bool readRequest(int connection, string& data, string& error)
+{
+    char buffer[65536];
+    while(true)
+    {
+        ssize_t readCount = recv(connection, buffer, sizeof(buffer), 0);
+        if(readCount == 0)
+            return true;
+        if(readCount < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                error = "Timed out waiting for the request";
+            else
+                error = string("Unable to read the request (") + strerror(errno) + ")";
+            return false;
+        }
+        if(data.size() + (size_t)readCount > MAX_REQUEST_SIZE)
+        {
+            error = "The request is too large";
+            return false;
+        }
+        data.append(buffer, (size_t)readCount);
+    }
+}
+
+static bool writeAll(int connection, const string& data)
+{
+    size_t written = 0;
+    while(written < data.size())
+    {
+        ssize_t writeCount = send(connection, data.data() + written, data.size() - written, 0);
+        if(writeCount < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        written += (size_t)writeCount;
+    }
+    return true;
+}
+#endif
+
+int runDaemon(const char* socketPath, const RunOptions& defaultOptions, float defaultTimeLimit)
+{
+#ifdef _WIN32
+    printf("Error: Daemon mode is only supported on Unix\n");
+    return -1;
+#else
+    // NOTE: A client that goes away before reading its reply shouldn't take the daemon with it
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        printf("Error: Socket path %s is too long\n", socketPath);
+        return -1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenSocket < 0)
+    {
+        printf("Error: Unable to create a socket (%s)\n", strerror(errno));
+        return -1;
+    }
+    // NOTE: A daemon that didn't shut down cleanly leaves its socket file behind, but anything
+    //       else at the path is left alone
+    struct stat pathInfo;
+    if(lstat(socketPath, &pathInfo) == 0)
+    {
+        if(!S_ISSOCK(pathInfo.st_mode))
+        {
+            printf("Error: %s already exists and isn't a socket\n", socketPath);
+            close(listenSocket);
+            return -1;
+        }
+        unlink(socketPath);
+    }
+    if((bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0) ||
+       (listen(listenSocket, SOMAXCONN) != 0))
+    {
+        printf("Error: Unable to listen on %s (%s)\n", socketPath, strerror(errno));
+        close(listenSocket);
+        return -1;
+    }
+    printf("Listening for jobs on %s\n", socketPath);
+    fflush(stdout);
+
+    DaemonState state;
+    state.defaultOptions = defaultOptions;
+    state.defaultTimeLimit = defaultTimeLimit;
+    state.jobCount = 0;
+
+    bool running = true;
+    while(running)
+    {
+        int connection = accept(listenSocket, nullptr, nullptr);
+        if(connection < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            printf("Error: Unable to accept a connection (%s)\n", strerror(errno));
+            break;
+        }
+
+        // NOTE: Jobs are handled one at a time, so a client that stalls must not hold up the rest
+        timeval timeout = {};
+        timeout.tv_sec = CONNECTION_TIMEOUT_SECONDS;
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        string request;
+        string response;
+        string error;
+        if(readRequest(connection, request, error))
+            running = handleRequest(state, request, response);
+        else
+            response = errorResponse(error);
+        writeAll(connection, response);
+        close(connection);
+        fflush(stdout);
+    }
+
+    close(listenSocket);
+    unlink(socketPath);
+    for(map<Sha256Digest, CachedProblem>::iterator cacheIt=state.cache.begin();
+        cacheIt!=state.cache.end();
+        cacheIt++)
+    {
+        freeInputStrings(cacheIt->second.problem.input);
+    }
+    return 0;
+#endif
+}
@@ -0,0 +1,45 @@
+#ifndef _DAEMON_H
+#define _DAEMON_H
+
+#include "fundmatch.h"
+
+// The most prepared problems that the daemon keeps around at once, after which the one that was
+// used least recently is dropped
+const int MAX_CACHED_PROBLEMS = 16;
+
+// The largest request that the daemon accepts (which is mostly inline CSV contents), in bytes
+const size_t MAX_REQUEST_SIZE = 256*1024*1024;
+
+// How long the daemon waits for a client to send the next part of its request, or to take the
+// next part of its reply, before it gives up on the connection
+const int CONNECTION_TIMEOUT_SECONDS = 30;
+
+// Runs as a daemon that listens on a Unix domain socket at the given path and solves one job for
+// each connection, until a client asks it to shut down. Returns the exit code for the process.
+// A client sends a single JSON object (of at most MAX_REQUEST_SIZE bytes) and then shuts down its
+// side of the connection. The object can contain:
+//   "command"      "solve" (the default) or "shutdown"
+//   "solver"       The solver to use, which must be this daemon's solver (see SOLVER_NAME)
+//   "dataset"      The name of a dataset in data/, as given on the command line, or instead...
+//   "sources", "balancePools" and "requirements"   ...the contents of the dataset's CSV files
+//   "seed", "gapTarget", "topK" and "horizon"      Options that override the daemon's own
+//   "deadline"     Seconds after which the solver stops searching (overrides --time-limit)
+//   "previous"     The path of an earlier output.json to re-optimize from incrementally, as with
+//                  --incremental (relative to the daemon's working directory)
+//   "warmStart"    The path of an earlier output.json or allocations CSV to start the search
+//                  from, as with --warm-start (relative to the daemon's working directory)
+// The daemon replies with a single status line, which is either
+//   "OK fitness=<f> allocations=<n> gap=<g> seconds=<s> cached=<0 or 1>"
+// followed by the solution in the same JSON format as output.json, or "ERROR <message>". The gap
+// is -1 if the solution is infeasible or the daemon was started with --no-bound.
+// Prepared problems (the parsed input, its allocation table and its lower bound) are cached by a
+// SHA-256 digest of the CSV contents and the options that they depend on, so a job on a book that
+// the daemon has seen before goes straight to solving. Only the digest is kept, not the contents.
+// Dataset files are read for every job, so changing them never gives a stale result.
+// NOTE: Jobs are solved one at a time, in the order that they arrive. The GA, PSO and GRASP solvers
+//       spread each job across every thread, and the others solve a job's independent components
+//       in parallel (see solveDecomposed), but a job that is a single component keeps only one
+//       thread busy.
+int runDaemon(const char* socketPath, const RunOptions& defaultOptions, float defaultTimeLimit);
+
+#endif // _DAEMON_H
@@ -1,7 +1,5 @@
 #include "dataio.h"
 
-#include "assert.h"
-
 #include <fstream>
 #include <vector>
 
@@ -13,12 +11,12 @@
 
 using namespace std;
 
-static TaxClass str2TaxClass(const char* str)
+static TaxClass str2TaxClass(const char* str, int length)
 {
+    if(length == 0)
+        return TaxClass::None;
     switch(*str)
     {
-        case '\0':
-            return TaxClass::None;
         case 'I':
             return TaxClass::IPF;
         case 'U':
@@ -26,7 +24,7 @@ static TaxClass str2TaxClass(const char* str)
         case 'C':
             return TaxClass::CF;
         default:
-            fprintf(stderr, "ERROR: Unrecognized tax class %s\n", str);
+            fprintf(stderr, "ERROR: Unrecognized tax class %.*s\n", length, str);
             return TaxClass::None;
     }
 }
@@ -48,112 +46,178 @@ static const char* taxClass2Str(TaxClass cls)
     }
 }
 
-bool loadSourceData(const char* inputFilename, InputData& input)
+static bool readSourceData(CsvReader& csvIn, InputData& input)
 {
-    CsvReader csvIn;
-    if(!csvIn.initialize(inputFilename))
+    if(csvIn.fieldCount() != 9)
         return false;
 
-    assert(csvIn.fieldCount() == 9);
     int entryCount = csvIn.entryCount();
+    size_t firstIndex = input.sources.size();
+    input.sources.reserve(firstIndex + entryCount);
     for(int i=0; i<entryCount; i++)
     {
         SourceInfo newInfo = {};
-        csvIn.readNextEntry();
-        int sourceID = atoi(csvIn.field(0));
-        assert(sourceID == i+1);
+        // NOTE: The input can come from a client of the daemon, so it is checked rather than
+        //       asserted, and nothing is kept from a malformed file
+        if(!csvIn.readNextEntry() || (csvIn.fieldInt(0) != i+1))
+        {
+            fprintf(stderr, "ERROR: Expected source %d on line %d\n", i+1, i+2);
+            input.sources.resize(firstIndex);
+            return false;
+        }
 
         csvIn.copyFieldStr(1, &newInfo.segment);
 
         int day, month, year;
-        sscanf(csvIn.field(2), "%d/%d/%d", &day, &month, &year);
+        csvIn.fieldDate(2, day, month, year);
         newInfo.startDate = year*12 + (month-1);
 
-        newInfo.tenor = atoi(csvIn.field(3));
-        newInfo.amount = atoi(csvIn.field(4));
+        newInfo.tenor = csvIn.fieldInt(3);
+        newInfo.amount = csvIn.fieldInt(4);
         csvIn.copyFieldStr(5, &newInfo.sourceType);
         csvIn.copyFieldStr(6, &newInfo.sourceTypeCategory);
-        newInfo.taxClass = str2TaxClass(csvIn.field(7));
-        newInfo.interestRate = (float)atof(csvIn.field(8));
+        newInfo.taxClass = str2TaxClass(csvIn.field(7), csvIn.fieldLength(7));
+        newInfo.interestRate = csvIn.fieldFloat(8);
 
         input.sources.push_back(newInfo);
     }
+    csvIn.takeStrings(input.stringBlocks);
 
     return true;
 }
 
-bool loadBalancePoolData(const char* inputFilename, InputData& input)
+static bool readBalancePoolData(CsvReader& csvIn, InputData& input)
 {
-    CsvReader csvIn;
-    if(!csvIn.initialize(inputFilename))
+    if(csvIn.fieldCount() != 10)
         return false;
 
-    assert(csvIn.fieldCount() == 10);
     int entryCount = csvIn.entryCount();
+    size_t firstIndex = input.balancePools.size();
+    input.balancePools.reserve(firstIndex + entryCount);
     for(int i=0; i<entryCount; i++)
     {
         BalancePoolInfo newInfo = {};
-        csvIn.readNextEntry();
-        int balanceID = atoi(csvIn.field(0));
-        assert(balanceID == i+1);
+        if(!csvIn.readNextEntry() || (csvIn.fieldInt(0) != i+1))
+        {
+            fprintf(stderr, "ERROR: Expected balance pool %d on line %d\n", i+1, i+2);
+            input.balancePools.resize(firstIndex);
+            return false;
+        }
 
         csvIn.copyFieldStr(1, &newInfo.segment);
         // NOTE: Field 2 is "BalancePoolID", which is always 1, so we left it out
 
         int day, month, year;
-        sscanf(csvIn.field(3), "%d/%d/%d", &day, &month, &year);
+        csvIn.fieldDate(3, day, month, year);
         newInfo.recordedDate = year*12 + (month-1);
 
         csvIn.copyFieldStr(4, &newInfo.name);
-        newInfo.recordedAmount = atoi(csvIn.field(5));
-        newInfo.amountLoanedOnRecordedDate = atoi(csvIn.field(6));
-        newInfo.totalAmount = atoi(csvIn.field(7));
-        newInfo.limitPercentage = (float)atof(csvIn.field(8));
-        newInfo.amount = (int)atof(csvIn.field(9));
+        newInfo.recordedAmount = csvIn.fieldInt(5);
+        newInfo.amountLoanedOnRecordedDate = csvIn.fieldInt(6);
+        newInfo.totalAmount = csvIn.fieldInt(7);
+        newInfo.limitPercentage = csvIn.fieldFloat(8);
+        newInfo.amount = (int)csvIn.fieldFloat(9);
 
         input.balancePools.push_back(newInfo);
     }
+    csvIn.takeStrings(input.stringBlocks);
 
     return true;
 }
 
-bool loadRequirementData(const char* inputFilename, InputData& input)
+static bool readRequirementData(CsvReader& csvIn, InputData& input)
 {
-    CsvReader csvIn;
-    if(!csvIn.initialize(inputFilename))
-        return false;
-
     int entryCount = csvIn.entryCount();
-    if(entryCount == 0)
+    if((entryCount <= 0) || (csvIn.fieldCount() != 8))
         return false;
 
-    assert(csvIn.fieldCount() == 8);
+    size_t firstIndex = input.requirements.size();
+    input.requirements.reserve(firstIndex + entryCount);
     for(int i=0; i<entryCount; i++)
     {
         RequirementInfo newInfo = {};
 
-        csvIn.readNextEntry();
-        int reqID = atoi(csvIn.field(0));
-        assert(reqID == i+1);
+        if(!csvIn.readNextEntry() || (csvIn.fieldInt(0) != i+1))
+        {
+            fprintf(stderr, "ERROR: Expected requirement %d on line %d\n", i+1, i+2);
+            input.requirements.resize(firstIndex);
+            return false;
+        }
 
         csvIn.copyFieldStr(1, &newInfo.segment);
 
         int day, month, year;
-        sscanf(csvIn.field(2), "%d/%d/%d", &day, &month, &year);
+        csvIn.fieldDate(2, day, month, year);
         newInfo.startDate = year*12 + (month-1);
 
-        newInfo.tenor = atoi(csvIn.field(3));
-        newInfo.amount = atoi(csvIn.field(4));
+        newInfo.tenor = csvIn.fieldInt(3);
+        newInfo.amount = csvIn.fieldInt(4);
         csvIn.copyFieldStr(5, &newInfo.tier);
         csvIn.copyFieldStr(6, &newInfo.purpose);
-        newInfo.taxClass = str2TaxClass(csvIn.field(7));
+        newInfo.taxClass = str2TaxClass(csvIn.field(7), csvIn.fieldLength(7));
 
         input.requirements.push_back(newInfo);
     }
+    csvIn.takeStrings(input.stringBlocks);
 
     return true;
 }
 
+bool loadSourceData(const char* inputFilename, InputData& input)
+{
+    CsvReader csvIn;
+    if(!csvIn.initialize(inputFilename))
+        return false;
+    return readSourceData(csvIn, input);
+}
+
+bool parseSourceData(const char* text, size_t length, InputData& input)
+{
+    CsvReader csvIn;
+    if(!csvIn.initialize(text, length))
+        return false;
+    return readSourceData(csvIn, input);
+}
+
+bool loadBalancePoolData(const char* inputFilename, InputData& input)
+{
+    CsvReader csvIn;
+    if(!csvIn.initialize(inputFilename))
+        return false;
+    return readBalancePoolData(csvIn, input);
+}
+
+bool parseBalancePoolData(const char* text, size_t length, InputData& input)
+{
+    CsvReader csvIn;
+    if(!csvIn.initialize(text, length))
+        return false;
+    return readBalancePoolData(csvIn, input);
+}
+
+bool loadRequirementData(const char* inputFilename, InputData& input)
+{
+    CsvReader csvIn;
+    if(!csvIn.initialize(inputFilename))
+        return false;
+    return readRequirementData(csvIn, input);
+}
+
+bool parseRequirementData(const char* text, size_t length, InputData& input)
+{
+    CsvReader csvIn;
+    if(!csvIn.initialize(text, length))
+        return false;
+    return readRequirementData(csvIn, input);
+}
+
+void freeInputStrings(InputData& input)
+{
+    for(int i=0; i<(int)input.stringBlocks.size(); i++)
+        delete[] input.stringBlocks[i];
+    input.stringBlocks.clear();
+}
+
 Vector loadAllocationData(const char* inputFilename, vector<AllocationPointer>& allocations)
 {
     CsvReader csvIn;
@@ -161,11 +225,11 @@ Vector loadAllocationData(const char* inputFilename, vector<AllocationPointer>&
         return Vector();
 
     int entryCount = csvIn.entryCount();
-    if(entryCount == 0)
+    if((entryCount <= 0) || (csvIn.fieldCount() != 7))
         return Vector();
 
     Vector result(entryCount * DIMENSIONS_PER_ALLOCATION);
-    assert(csvIn.fieldCount() == 7);
+    allocations.reserve(allocations.size() + entryCount);
     for(int i=0; i<entryCount; i++)
     {
         csvIn.readNextEntry();
@@ -173,16 +237,16 @@ Vector loadAllocationData(const char* inputFilename, vector<AllocationPointer>&
         newAlloc.allocStartDimension = i*DIMENSIONS_PER_ALLOCATION;
 
         // NOTE: We subtract 1 here because we're using 0-based indices and the data uses 1-based
-        newAlloc.requirementIndex = atoi(csvIn.field(1)) - 1;
-        newAlloc.sourceIndex = atoi(csvIn.field(2)) - 1;
-        newAlloc.balancePoolIndex = atoi(csvIn.field(3)) - 1;
+        newAlloc.requirementIndex = csvIn.fieldInt(1) - 1;
+        newAlloc.sourceIndex = csvIn.fieldInt(2) - 1;
+        newAlloc.balancePoolIndex = csvIn.fieldInt(3) - 1;
 
         int day, month, year;
-        sscanf(csvIn.field(4), "%d/%d/%d", &day, &month, &year);
+        csvIn.fieldDate(4, day, month, year);
         int startDate = year*12 + (month-1);
 
-        int tenor = atoi(csvIn.field(5));
-        int amount = atoi(csvIn.field(6));
+        int tenor = csvIn.fieldInt(5);
+        int amount = csvIn.fieldInt(6);
 
         newAlloc.setStartDate(result, (float)startDate);
         newAlloc.setTenor(result, (float)tenor);
@@ -193,9 +257,132 @@ Vector loadAllocationData(const char* inputFilename, vector<AllocationPointer>&
     return result;
 }
 
-int writeOutputData(InputData input, int allocCount, AllocationPointer* allocations,
-                     Vector solution, const char* outFilename)
+static char* copyString(InputData& input, const string& str)
 {
+    char* strBuffer = new char[str.size() + 1];
+    strcpy(strBuffer, str.c_str());
+    input.stringBlocks.push_back(strBuffer);
+    return strBuffer;
+}
+
+// Parses a date in the format that writeOutputData uses
+static int parseOutputDate(const Jzon::Node& node)
+{
+    int day, month, year;
+    if(sscanf(node.toString().c_str(), "%d-%d-%d", &day, &month, &year) != 3)
+        return 0;
+    return year*12 + (month-1);
+}
+
+Vector loadOutputData(const char* inputFilename, InputData& input,
+                      vector<AllocationPointer>& allocations)
+{
+    Jzon::Parser parser;
+    Jzon::Node rootNode = parser.parseFile(inputFilename);
+    Jzon::Node sourceNodeList = rootNode.get("sources");
+    Jzon::Node reqNodeList = rootNode.get("requirements");
+    Jzon::Node bplNodeList = rootNode.get("balancePools");
+    Jzon::Node allocNodeList = rootNode.get("allocations");
+    if(!sourceNodeList.isArray() || !reqNodeList.isArray() || !bplNodeList.isArray() ||
+       !allocNodeList.isArray())
+    {
+        return Vector();
+    }
+
+    for(size_t sourceID=0; sourceID<sourceNodeList.getCount(); sourceID++)
+    {
+        Jzon::Node sourceNode = sourceNodeList.get(sourceID);
+        SourceInfo newInfo = {};
+        newInfo.segment = copyString(input, "");
+        newInfo.startDate = parseOutputDate(sourceNode.get("startDate"));
+        newInfo.tenor = sourceNode.get("tenor").toInt();
+        newInfo.amount = sourceNode.get("amount").toInt();
+        newInfo.sourceType = copyString(input, "");
+        newInfo.sourceTypeCategory = copyString(input, "");
+        string sourceTaxClass = sourceNode.get("taxClass").toString();
+        newInfo.taxClass = str2TaxClass(sourceTaxClass.c_str(), (int)sourceTaxClass.size());
+        newInfo.interestRate = sourceNode.get("interestRate").toFloat();
+        input.sources.push_back(newInfo);
+    }
+
+    for(size_t reqID=0; reqID<reqNodeList.getCount(); reqID++)
+    {
+        Jzon::Node reqNode = reqNodeList.get(reqID);
+        RequirementInfo newInfo = {};
+        newInfo.segment = copyString(input, "");
+        newInfo.startDate = parseOutputDate(reqNode.get("startDate"));
+        newInfo.tenor = reqNode.get("tenor").toInt();
+        newInfo.amount = reqNode.get("amount").toInt();
+        newInfo.tier = copyString(input, "");
+        newInfo.purpose = copyString(input, "");
+        string reqTaxClass = reqNode.get("taxClass").toString();
+        newInfo.taxClass = str2TaxClass(reqTaxClass.c_str(), (int)reqTaxClass.size());
+        input.requirements.push_back(newInfo);
+    }
+
+    for(size_t balanceID=0; balanceID<bplNodeList.getCount(); balanceID++)
+    {
+        Jzon::Node bplNode = bplNodeList.get(balanceID);
+        BalancePoolInfo newInfo = {};
+        newInfo.segment = copyString(input, bplNode.get("segment").toString());
+        newInfo.recordedDate = parseOutputDate(bplNode.get("recordedDate"));
+        newInfo.name = copyString(input, bplNode.get("name").toString());
+        newInfo.recordedAmount = bplNode.get("recordedAmount").toInt();
+        newInfo.amountLoanedOnRecordedDate = bplNode.get("amountLoanedOnRecordedDate").toInt();
+        newInfo.totalAmount = bplNode.get("totalAmount").toInt();
+        newInfo.limitPercentage = bplNode.get("limitPercentage").toFloat();
+        newInfo.amount = bplNode.get("amount").toInt();
+        input.balancePools.push_back(newInfo);
+    }
+
+    int allocCount = (int)allocNodeList.getCount();
+    Vector result(allocCount * DIMENSIONS_PER_ALLOCATION);
+    for(int i=0; i<allocCount; i++)
+    {
+        Jzon::Node allocNode = allocNodeList.get(i);
+        AllocationPointer newAlloc = {};
+        newAlloc.allocStartDimension = i*DIMENSIONS_PER_ALLOCATION;
+        newAlloc.sourceIndex = allocNode.get("sourceIndex").toInt(-1);
+        newAlloc.balancePoolIndex = allocNode.get("balancePoolIndex").toInt(-1);
+        newAlloc.requirementIndex = allocNode.get("requirementIndex").toInt(-1);
+
+        // NOTE: Allocations that refer to something that isn't in the file are kept (so that the
+        //       solution still lines up with the allocations), but they are left empty
+        bool isValid = (newAlloc.requirementIndex >= 0) &&
+                       (newAlloc.requirementIndex < (int)input.requirements.size()) &&
+                       (newAlloc.sourceIndex < (int)input.sources.size()) &&
+                       (newAlloc.balancePoolIndex < (int)input.balancePools.size()) &&
+                       ((newAlloc.sourceIndex >= 0) != (newAlloc.balancePoolIndex >= 0));
+        if(!isValid)
+        {
+            newAlloc.requirementIndex = 0;
+            newAlloc.sourceIndex = -1;
+            newAlloc.balancePoolIndex = -1;
+        }
+        newAlloc.setStartDate(result, (float)parseOutputDate(allocNode.get("startDate")));
+        newAlloc.setTenor(result, isValid ? (float)allocNode.get("tenor").toInt() : 0.0f);
+        newAlloc.setAmount(result, isValid ? (float)allocNode.get("amount").toInt() : 0.0f);
+
+        allocations.push_back(newAlloc);
+    }
+    return result;
+}
+
+int writeOutputData(const ProblemInstance& problem, const Vector& solution,
+                    const char* outFilename)
+{
+    std::ofstream outFile(outFilename, std::ofstream::out);
+    int nonEmptyAllocationCount = writeOutputData(problem, solution, outFile);
+    outFile.close();
+    return nonEmptyAllocationCount;
+}
+
+int writeOutputData(const ProblemInstance& problem, const Vector& solution, std::ostream& out)
+{
+    const InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    const AllocationPointer* allocations = problem.allocations.data();
+
     Jzon::Node rootNode = Jzon::object();
 
     Jzon::Node sourceNodeList = Jzon::array();
@@ -236,7 +423,7 @@ int writeOutputData(InputData input, int allocCount, AllocationPointer* allocati
     Jzon::Node bplNodeList = Jzon::array();
     for(int balanceID=0; balanceID<input.balancePools.size(); balanceID++)
     {
-        BalancePoolInfo& bpl = input.balancePools[balanceID];
+        const BalancePoolInfo& bpl = input.balancePools[balanceID];
         int month = (bpl.recordedDate % 12)+1;
         int year = bpl.recordedDate / 12;
         snprintf(dateStr, MAX_DATE_STR_LEN, "01-%02d-%04d", month, year);
@@ -285,9 +472,7 @@ int writeOutputData(InputData input, int allocCount, AllocationPointer* allocati
     rootNode.add("allocations", allocNodeList);
 
     Jzon::Writer writer;
-    std::ofstream outFile(outFilename, std::ofstream::out);
-    writer.writeStream(rootNode, outFile);
-    outFile.close();
+    writer.writeStream(rootNode, out);
 
     return nonEmptyAllocationCount;
 }
@@ -1,6 +1,8 @@
 #ifndef _DATA_IO_H
 #define _DATA_IO_H
 
+#include <ostream>
+
 #include "fundmatch.h"
 
 // Allocates an array of SourceInfo, and puts it into input.sources.
@@ -15,13 +17,33 @@ bool loadBalancePoolData(const char* inputFilename, InputData& input);
 // Returns true iff the function succeeded, if false is returned then input will not be modified.
 bool loadRequirementData(const char* inputFilename, InputData& input);
 
+// The same as the three functions above, but for CSV text that has already been read into memory
+bool parseSourceData(const char* text, size_t length, InputData& input);
+bool parseBalancePoolData(const char* text, size_t length, InputData& input);
+bool parseRequirementData(const char* text, size_t length, InputData& input);
+
+// Frees the strings that the functions above allocated for the given input
+// NOTE: Copies of an input share its strings, so this must only be called once none of them are
+//       still in use
+void freeInputStrings(InputData& input);
+
 // Loads allocations from a csv file. Fills AllocationPointer vector with AllocationPointers for each
 // allocation, and returns the Vector with the values from the file that correspond to those pointers
+// (or a Vector with no dimensions if the file couldn't be loaded, is empty or has the wrong columns)
 Vector loadAllocationData(const char* inputFilename, std::vector<AllocationPointer>& allocations);
 
+// Loads a solution that was written by writeOutputData, along with the input that it was for.
+// The input only has the fields that writeOutputData includes, so the sources and requirements
+// have empty segments, types, tiers and purposes. Fills the AllocationPointer vector with an
+// AllocationPointer for each allocation in the file, and returns the Vector with their values (or
+// a Vector with no dimensions if the file couldn't be loaded or has no allocations).
+Vector loadOutputData(const char* inputFilename, InputData& input,
+                      std::vector<AllocationPointer>& allocations);
+
 // Serialize the sources, requirements and allocations into a JSON string and writes it to file
 // Returns the number of non-empty requirements (>0 tenor and amount) that were written
-int writeOutputData(InputData input, int allocCount, AllocationPointer* allocations,
-                     Vector solution, const char* outFilename);
+int writeOutputData(const ProblemInstance& problem, const Vector& solution,
+                    const char* outFilename);
+int writeOutputData(const ProblemInstance& problem, const Vector& solution, std::ostream& out);
 
 #endif
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "decompose.h"
+#include "fundmatch.h"
+#include "presolve.h"
+#include "parallel.h"
+
+using namespace std;
+
+static int findRoot(vector<int>& parent, int node)
+{
+    while(parent[node] != node)
+    {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+static void unite(vector<int>& parent, int nodeA, int nodeB)
+{
+    int rootA = findRoot(parent, nodeA);
+    int rootB = findRoot(parent, nodeB);
+    if(rootA != rootB)
+        parent[max(rootA, rootB)] = min(rootA, rootB);
+}
+
+int findComponents(const ProblemInstance& problem, vector<int>& allocComponent)
+{
+    const InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    const AllocationPointer* allocations = problem.allocations.data();
+    int reqCount = (int)input.requirements.size();
+
+    // Find the connected components, with requirements as nodes [0, reqCount) and sources after
+    vector<int> parent(reqCount + input.sources.size());
+    for(int node=0; node<(int)parent.size(); node++)
+        parent[node] = node;
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        const AllocationPointer& alloc = allocations[allocIndex];
+        if(alloc.sourceIndex >= 0)
+            unite(parent, alloc.requirementIndex, reqCount + alloc.sourceIndex);
+    }
+
+    // NOTE: Components are numbered in order of their first allocation so that the decomposition
+    //       (and hence the result) is deterministic
+    vector<int> rootComponent(parent.size(), -1);
+    allocComponent.resize(allocCount);
+    int componentCount = 0;
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        int root = findRoot(parent, allocations[allocIndex].requirementIndex);
+        if(rootComponent[root] < 0)
+            rootComponent[root] = componentCount++;
+        allocComponent[allocIndex] = rootComponent[root];
+    }
+    return componentCount;
+}
+
+Vector solveDecomposed(ProblemInstance& problem)
+{
+    InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+    int poolCount = (int)input.balancePools.size();
+
+    vector<int> allocComponent;
+    int componentCount = findComponents(problem, allocComponent);
+    vector<int> componentSizes(componentCount, 0);
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+        componentSizes[allocComponent[allocIndex]]++;
+    if(componentCount <= 1)
+        return computeAllocations(problem);
+
+    // Group the small components together, largest first
+    vector<int> componentOrder(componentCount);
+    for(int i=0; i<componentCount; i++)
+        componentOrder[i] = i;
+    stable_sort(componentOrder.begin(), componentOrder.end(), [&componentSizes](int a, int b)
+    {
+        return componentSizes[a] > componentSizes[b];
+    });
+    vector<int> componentSubproblem(componentCount);
+    int subproblemCount = 0;
+    int currentSize = MIN_SUBPROBLEM_ALLOCATIONS;
+    for(int i=0; i<componentCount; i++)
+    {
+        if(currentSize >= MIN_SUBPROBLEM_ALLOCATIONS)
+        {
+            subproblemCount++;
+            currentSize = 0;
+        }
+        componentSubproblem[componentOrder[i]] = subproblemCount-1;
+        currentSize += componentSizes[componentOrder[i]];
+    }
+    printf("Decomposed into %d independent components, solved as %d subproblems\n",
+           componentCount, subproblemCount);
+    if(subproblemCount == 1)
+        return computeAllocations(problem);
+
+    // Split every balance pool's budget between the subproblems
+    vector<ReducedProblem> subproblems(subproblemCount);
+    vector<double> poolDemand(subproblemCount*poolCount, 0.0);
+    vector<double> poolTotalDemand(poolCount, 0.0);
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        int subproblemIndex = componentSubproblem[allocComponent[allocIndex]];
+        subproblems[subproblemIndex].instance.allocations.push_back(alloc);
+        subproblems[subproblemIndex].originalAllocations.push_back(allocIndex);
+
+        if(alloc.balancePoolIndex >= 0)
+        {
+            double demand = (double)max(input.requirements[alloc.requirementIndex].amount, 0);
+            poolDemand[subproblemIndex*poolCount + alloc.balancePoolIndex] += demand;
+            poolTotalDemand[alloc.balancePoolIndex] += demand;
+        }
+    }
+
+    // NOTE: The slices are rounded down, so they never add up to more than the original budget
+    for(int subproblemIndex=0; subproblemIndex<subproblemCount; subproblemIndex++)
+    {
+        ReducedProblem& subproblem = subproblems[subproblemIndex];
+        subproblem.instance.input.balancePools = input.balancePools;
+        for(int poolIndex=0; poolIndex<poolCount; poolIndex++)
+        {
+            double share = 0.0;
+            if(poolTotalDemand[poolIndex] > 0.0)
+                share = poolDemand[subproblemIndex*poolCount + poolIndex]/poolTotalDemand[poolIndex];
+            BalancePoolInfo& slice = subproblem.instance.input.balancePools[poolIndex];
+            slice.amount = (int)(share*(double)slice.amount);
+        }
+        compactProblem(problem, subproblem);
+        subproblem.instance.options.gapTarget = 0.0f;
+    }
+
+    // NOTE: Every subproblem is a problem of its own and fills in its own allocations of the
+    //       result, so the subproblems can be solved in parallel. Solvers that already use every
+    //       thread solve them one at a time instead, so as not to oversubscribe the threads.
+    Vector result(allocCount * DIMENSIONS_PER_ALLOCATION);
+    auto solveSubproblem = [&](int subproblemIndex)
+    {
+        ReducedProblem& subproblem = subproblems[subproblemIndex];
+        int subAllocCount = (int)subproblem.instance.allocations.size();
+        Vector subSolution = computeAllocations(subproblem.instance);
+
+        for(int i=0; i<subAllocCount; i++)
+        {
+            AllocationPointer& alloc = allocations[subproblem.originalAllocations[i]];
+            AllocationPointer& subAlloc = subproblem.instance.allocations[i];
+            alloc.setStartDate(result, subAlloc.getStartDate(subSolution));
+            alloc.setTenor(result, subAlloc.getTenor(subSolution));
+            alloc.setAmount(result, subAlloc.getAmount(subSolution));
+        }
+    };
+    if(SOLVER_IS_PARALLEL)
+    {
+        for(int subproblemIndex=0; subproblemIndex<subproblemCount; subproblemIndex++)
+            solveSubproblem(subproblemIndex);
+    }
+    else
+    {
+        parallelFor(subproblemCount, solveSubproblem);
+    }
+
+    return result;
+}
@@ -0,0 +1,32 @@
+#ifndef _DECOMPOSE_H
+#define _DECOMPOSE_H
+
+#include <vector>
+
+#include "fundmatch.h"
+
+// Independent components with fewer allocations than this are grouped together into a single
+// subproblem, so that the solvers' fixed per-run costs aren't paid for every tiny component
+const int MIN_SUBPROBLEM_ALLOCATIONS = 256;
+
+// Finds the independent components of the given problem, where two requirements are only
+// dependent if they can share a source (directly, or through a chain of other requirements and
+// sources). Fills allocComponent with the component of every allocation, where components are
+// numbered in order of their first allocation.
+// Returns the number of components.
+int findComponents(const ProblemInstance& problem, std::vector<int>& allocComponent);
+
+// Splits the given problem into independent subproblems and solves each of them with
+// computeAllocations, then merges their solutions into a single solution for all of them.
+// Since allocations only exist between sources and requirements that overlap in time, this also
+// splits the problem wherever there is a month that no source/requirement pair spans.
+// Balance pools are shared by every requirement, so instead each subproblem is given a slice of
+// every balance pool's budget, in proportion to the total amount of its requirements that could
+// use that pool. Polishing afterwards works on the whole problem, so it can still move budget
+// between the subproblems.
+// The subproblems are solved in parallel, unless the solver already uses every thread itself (see
+// SOLVER_IS_PARALLEL).
+// NOTE: The gap target is ignored by the subproblems, since the lower bound is for the whole problem
+Vector solveDecomposed(ProblemInstance& problem);
+
+#endif // _DECOMPOSE_H
@@ -0,0 +1,396 @@
+#include <assert.h>
+#include <float.h>
+#include <limits.h>
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+#include "flow.h"
+#include "fundmatch.h"
+
+using namespace std;
+
+static const double COST_EPSILON = 1e-9;
+
+FlowNetwork::FlowNetwork(int nodeCount)
+    : nodeArcs(nodeCount), potential(nodeCount, 0.0)
+{
+}
+
+int FlowNetwork::addArc(int fromNode, int toNode, int capacity, double cost)
+{
+    int arcID = (int)arcs.size();
+    Arc forward = {toNode, capacity, cost};
+    Arc reverse = {fromNode, 0, -cost};
+    arcs.push_back(forward);
+    arcs.push_back(reverse);
+    nodeArcs[fromNode].push_back(arcID);
+    nodeArcs[toNode].push_back(arcID + 1);
+    return arcID;
+}
+
+int FlowNetwork::getFlow(int arcID) const
+{
+    return arcs[arcID ^ 1].capacity;
+}
+
+void FlowNetwork::initializePotentials(int sourceNode)
+{
+    // NOTE: Nodes that can't be reached from the source now can never be reached (since new
+    //       residual arcs only ever lead back to nodes that were on a path from the source), so
+    //       it doesn't matter what potential they get
+    int nodeCount = (int)nodeArcs.size();
+    vector<double> distance(nodeCount, DBL_MAX);
+    vector<bool> queued(nodeCount, false);
+    queue<int> pending;
+    distance[sourceNode] = 0.0;
+    pending.push(sourceNode);
+    queued[sourceNode] = true;
+    while(!pending.empty())
+    {
+        int node = pending.front();
+        pending.pop();
+        queued[node] = false;
+        for(int i=0; i<(int)nodeArcs[node].size(); i++)
+        {
+            const Arc& arc = arcs[nodeArcs[node][i]];
+            if((arc.capacity > 0) &&
+               (distance[node] + arc.cost < distance[arc.toNode] - COST_EPSILON))
+            {
+                distance[arc.toNode] = distance[node] + arc.cost;
+                if(!queued[arc.toNode])
+                {
+                    pending.push(arc.toNode);
+                    queued[arc.toNode] = true;
+                }
+            }
+        }
+    }
+
+    for(int node=0; node<nodeCount; node++)
+    {
+        potential[node] = (distance[node] == DBL_MAX) ? 0.0 : distance[node];
+    }
+}
+
+double FlowNetwork::minimizeCost(int sourceNode, int sinkNode)
+{
+    initializePotentials(sourceNode);
+
+    int nodeCount = (int)nodeArcs.size();
+    vector<double> distance(nodeCount);
+    vector<int> pathArc(nodeCount);
+    typedef pair<double, int> QueueEntry;
+    double totalCost = 0.0;
+    while(true)
+    {
+        // Find the cheapest path using the reduced costs, which are never negative
+        fill(distance.begin(), distance.end(), DBL_MAX);
+        fill(pathArc.begin(), pathArc.end(), -1);
+        priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> pending;
+        distance[sourceNode] = 0.0;
+        pending.push(QueueEntry(0.0, sourceNode));
+        while(!pending.empty())
+        {
+            QueueEntry entry = pending.top();
+            pending.pop();
+            int node = entry.second;
+            if(entry.first > distance[node])
+                continue;
+
+            for(int i=0; i<(int)nodeArcs[node].size(); i++)
+            {
+                int arcID = nodeArcs[node][i];
+                const Arc& arc = arcs[arcID];
+                if(arc.capacity <= 0)
+                    continue;
+
+                double reducedCost = arc.cost + potential[node] - potential[arc.toNode];
+                double newDistance = distance[node] + max(reducedCost, 0.0);
+                if(newDistance < distance[arc.toNode])
+                {
+                    distance[arc.toNode] = newDistance;
+                    pathArc[arc.toNode] = arcID;
+                    pending.push(QueueEntry(newDistance, arc.toNode));
+                }
+            }
+        }
+
+        if(distance[sinkNode] == DBL_MAX)
+            break;
+        double pathCost = distance[sinkNode] + potential[sinkNode] - potential[sourceNode];
+
+        // NOTE: Limiting every distance to that of the sink keeps all of the reduced costs
+        //       non-negative, even for nodes that we didn't reach in this search
+        for(int node=0; node<nodeCount; node++)
+        {
+            potential[node] += min(distance[node], distance[sinkNode]);
+        }
+
+        if(pathCost >= -COST_EPSILON)
+            break;
+
+        int bottleneck = INT_MAX;
+        for(int node=sinkNode; node!=sourceNode; node=arcs[pathArc[node] ^ 1].toNode)
+        {
+            bottleneck = min(bottleneck, arcs[pathArc[node]].capacity);
+        }
+        for(int node=sinkNode; node!=sourceNode; node=arcs[pathArc[node] ^ 1].toNode)
+        {
+            arcs[pathArc[node]].capacity -= bottleneck;
+            arcs[pathArc[node] ^ 1].capacity += bottleneck;
+        }
+        totalCost += (double)bottleneck * pathCost;
+    }
+
+    return totalCost;
+}
+
+// A set of indices that supports adding, removing and iterating in O(1) (per element)
+struct ActiveSet
+{
+    vector<int> members;
+    vector<int> memberPosition; // The position of each index in members, or -1
+
+    explicit ActiveSet(int indexCount)
+        : memberPosition(indexCount, -1)
+    {
+    }
+
+    void add(int index)
+    {
+        memberPosition[index] = (int)members.size();
+        members.push_back(index);
+    }
+
+    void remove(int index)
+    {
+        int position = memberPosition[index];
+        members[position] = members.back();
+        memberPosition[members[position]] = position;
+        members.pop_back();
+        memberPosition[index] = -1;
+    }
+};
+
+// Solves the transportation problem for a single month with the given active sources and
+// requirements, and returns its (per-month) cost, not including the RCF cost of the requirements
+static double solveMonth(InputData& input,
+                         const vector<int>& activeSources, const vector<int>& activeRequirements,
+                         bool includeBalancePools, int fromMonth, int toMonth,
+                         vector<RelaxedFlow>* flows)
+{
+    int sourceCount = (int)activeSources.size();
+    int poolCount = includeBalancePools ? (int)input.balancePools.size() : 0;
+    int reqCount = (int)activeRequirements.size();
+
+    // NOTE: Node 0 is the super-source, node 1 is the super-sink, then come the sources, the
+    //       balance pools and finally the requirements
+    const int superSource = 0;
+    const int superSink = 1;
+    int firstSourceNode = 2;
+    int firstPoolNode = firstSourceNode + sourceCount;
+    int firstReqNode = firstPoolNode + poolCount;
+    FlowNetwork network(firstReqNode + reqCount);
+
+    // NOTE: Giving the RCF a cost of zero (rather than adding it as another supply) means that
+    //       each arc's cost is the saving (as a negative cost) from using it instead of the RCF
+    struct FlowArc
+    {
+        int arcID;
+        int sourceIndex;
+        int balancePoolIndex;
+        int requirementIndex;
+    };
+    vector<FlowArc> flowArcs;
+
+    for(int i=0; i<sourceCount; i++)
+    {
+        SourceInfo& src = input.sources[activeSources[i]];
+        network.addArc(superSource, firstSourceNode + i, src.amount, 0.0);
+        for(int j=0; j<reqCount; j++)
+        {
+            RequirementInfo& req = input.requirements[activeRequirements[j]];
+            if(src.taxClass != req.taxClass)
+                continue;
+
+            double cost = (double)src.interestRate - (double)RCF_INTEREST_RATE;
+            FlowArc flowArc;
+            flowArc.arcID = network.addArc(firstSourceNode + i, firstReqNode + j, req.amount, cost);
+            flowArc.sourceIndex = activeSources[i];
+            flowArc.balancePoolIndex = -1;
+            flowArc.requirementIndex = activeRequirements[j];
+            flowArcs.push_back(flowArc);
+        }
+    }
+    for(int i=0; i<poolCount; i++)
+    {
+        BalancePoolInfo& pool = input.balancePools[i];
+        network.addArc(superSource, firstPoolNode + i, pool.amount, 0.0);
+        for(int j=0; j<reqCount; j++)
+        {
+            RequirementInfo& req = input.requirements[activeRequirements[j]];
+            double cost = (double)BALANCEPOOL_INTEREST_RATE - (double)RCF_INTEREST_RATE;
+            FlowArc flowArc;
+            flowArc.arcID = network.addArc(firstPoolNode + i, firstReqNode + j, req.amount, cost);
+            flowArc.sourceIndex = -1;
+            flowArc.balancePoolIndex = i;
+            flowArc.requirementIndex = activeRequirements[j];
+            flowArcs.push_back(flowArc);
+        }
+    }
+    for(int j=0; j<reqCount; j++)
+    {
+        RequirementInfo& req = input.requirements[activeRequirements[j]];
+        network.addArc(firstReqNode + j, superSink, req.amount, 0.0);
+    }
+
+    double cost = network.minimizeCost(superSource, superSink);
+
+    if(flows)
+    {
+        for(int i=0; i<(int)flowArcs.size(); i++)
+        {
+            int amount = network.getFlow(flowArcs[i].arcID);
+            if(amount <= 0)
+                continue;
+
+            RelaxedFlow flow;
+            flow.sourceIndex = flowArcs[i].sourceIndex;
+            flow.balancePoolIndex = flowArcs[i].balancePoolIndex;
+            flow.requirementIndex = flowArcs[i].requirementIndex;
+            flow.fromMonth = fromMonth;
+            flow.toMonth = toMonth;
+            flow.amount = amount;
+            flows->push_back(flow);
+        }
+    }
+    return cost;
+}
+
+static int sourceStart(const InputData& input, int srcIndex)
+{
+    return input.sources[srcIndex].startDate;
+}
+
+static int sourceEnd(const InputData& input, int srcIndex)
+{
+    return input.sources[srcIndex].startDate + input.sources[srcIndex].tenor;
+}
+
+static int requirementStart(const InputData& input, int reqIndex)
+{
+    return input.requirements[reqIndex].startDate;
+}
+
+static int requirementEnd(const InputData& input, int reqIndex)
+{
+    return input.requirements[reqIndex].startDate + input.requirements[reqIndex].tenor;
+}
+
+double solveMonthlyRelaxation(InputData& input, bool includeBalancePools,
+                              vector<RelaxedFlow>* flows)
+{
+    int sourceCount = (int)input.sources.size();
+    int reqCount = (int)input.requirements.size();
+
+    // NOTE: Sources that cost at least as much as the RCF would never be used, so we leave them
+    //       out entirely (along with any sources or requirements that have no tenor)
+    vector<int> sourcesByStart;
+    for(int srcIndex=0; srcIndex<sourceCount; srcIndex++)
+    {
+        SourceInfo& src = input.sources[srcIndex];
+        if((src.tenor >= 1) && (src.amount > 0) && (src.interestRate < RCF_INTEREST_RATE))
+            sourcesByStart.push_back(srcIndex);
+    }
+    vector<int> requirementsByStart;
+    double result = 0.0;
+    for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+    {
+        RequirementInfo& req = input.requirements[reqIndex];
+        if((req.tenor < 1) || (req.amount <= 0))
+            continue;
+        requirementsByStart.push_back(reqIndex);
+        result += (double)RCF_INTEREST_RATE * (double)req.amount * (double)req.tenor;
+    }
+    vector<int> sourcesByEnd(sourcesByStart);
+    vector<int> requirementsByEnd(requirementsByStart);
+
+    sort(sourcesByStart.begin(), sourcesByStart.end(), [&input](int a, int b)
+    {
+        return sourceStart(input, a) < sourceStart(input, b);
+    });
+    sort(sourcesByEnd.begin(), sourcesByEnd.end(), [&input](int a, int b)
+    {
+        return sourceEnd(input, a) < sourceEnd(input, b);
+    });
+    sort(requirementsByStart.begin(), requirementsByStart.end(), [&input](int a, int b)
+    {
+        return requirementStart(input, a) < requirementStart(input, b);
+    });
+    sort(requirementsByEnd.begin(), requirementsByEnd.end(), [&input](int a, int b)
+    {
+        return requirementEnd(input, a) < requirementEnd(input, b);
+    });
+
+    // Every month in which the set of active sources or requirements changes
+    vector<int> eventMonths;
+    for(int i=0; i<(int)sourcesByStart.size(); i++)
+    {
+        eventMonths.push_back(sourceStart(input, sourcesByStart[i]));
+        eventMonths.push_back(sourceEnd(input, sourcesByStart[i]));
+    }
+    for(int i=0; i<(int)requirementsByStart.size(); i++)
+    {
+        eventMonths.push_back(requirementStart(input, requirementsByStart[i]));
+        eventMonths.push_back(requirementEnd(input, requirementsByStart[i]));
+    }
+    sort(eventMonths.begin(), eventMonths.end());
+    eventMonths.erase(unique(eventMonths.begin(), eventMonths.end()), eventMonths.end());
+
+    ActiveSet activeSources(sourceCount);
+    ActiveSet activeRequirements(reqCount);
+    int sourceStartIndex = 0;
+    int sourceEndIndex = 0;
+    int reqStartIndex = 0;
+    int reqEndIndex = 0;
+    for(int eventIndex=0; eventIndex+1<(int)eventMonths.size(); eventIndex++)
+    {
+        int month = eventMonths[eventIndex];
+        int sourcesEnded = (int)sourcesByEnd.size();
+        while((sourceEndIndex < sourcesEnded) &&
+              (sourceEnd(input, sourcesByEnd[sourceEndIndex]) <= month))
+            activeSources.remove(sourcesByEnd[sourceEndIndex++]);
+        int sourcesStarted = (int)sourcesByStart.size();
+        while((sourceStartIndex < sourcesStarted) &&
+              (sourceStart(input, sourcesByStart[sourceStartIndex]) <= month))
+            activeSources.add(sourcesByStart[sourceStartIndex++]);
+        int reqsEnded = (int)requirementsByEnd.size();
+        while((reqEndIndex < reqsEnded) &&
+              (requirementEnd(input, requirementsByEnd[reqEndIndex]) <= month))
+            activeRequirements.remove(requirementsByEnd[reqEndIndex++]);
+        int reqsStarted = (int)requirementsByStart.size();
+        while((reqStartIndex < reqsStarted) &&
+              (requirementStart(input, requirementsByStart[reqStartIndex]) <= month))
+            activeRequirements.add(requirementsByStart[reqStartIndex++]);
+
+        if(activeRequirements.members.empty())
+            continue;
+
+        // NOTE: We sort the active indices so that the result doesn't depend on the order in
+        //       which they were added/removed
+        vector<int> segmentSources(activeSources.members);
+        vector<int> segmentRequirements(activeRequirements.members);
+        sort(segmentSources.begin(), segmentSources.end());
+        sort(segmentRequirements.begin(), segmentRequirements.end());
+
+        int nextMonth = eventMonths[eventIndex+1];
+        double monthCost = solveMonth(input, segmentSources, segmentRequirements,
+                                      includeBalancePools, month, nextMonth, flows);
+        result += (double)(nextMonth - month) * monthCost;
+    }
+
+    return result;
+}
@@ -0,0 +1,69 @@
+#ifndef _FLOW_H
+#define _FLOW_H
+
+#include <vector>
+
+#include "fundmatch.h"
+
+// A network in which we can find a flow of minimum cost, using successive shortest paths.
+// Each shortest path search is a Dijkstra search over costs that are made non-negative by node
+// potentials, which are initialized with a Bellman-Ford search (so arcs can have negative costs,
+// but there must not be any cycles of negative cost).
+class FlowNetwork
+{
+public:
+    explicit FlowNetwork(int nodeCount);
+
+    // Adds an arc with the given capacity and cost per unit of flow, and returns its ID
+    int addArc(int fromNode, int toNode, int capacity, double cost);
+
+    // Sends flow from sourceNode to sinkNode, along the cheapest remaining path each time, for as
+    // long as there is a path with negative cost (IE until sending more would only cost more).
+    // Returns the total cost of the resulting flow.
+    double minimizeCost(int sourceNode, int sinkNode);
+
+    // Returns the amount that is flowing along the given arc
+    int getFlow(int arcID) const;
+
+private:
+    // NOTE: Each arc is stored together with its reverse (residual) arc, at the ID with the
+    //       lowest bit flipped
+    struct Arc
+    {
+        int toNode;
+        int capacity; // The remaining capacity
+        double cost;
+    };
+
+    void initializePotentials(int sourceNode);
+
+    std::vector<Arc> arcs;
+    std::vector<std::vector<int>> nodeArcs; // The IDs of the arcs leaving each node
+    std::vector<double> potential;
+};
+
+// The amount that flows from a source (or balance pool) to a requirement in every month of a range
+// of months, in a solution to the monthly relaxation
+struct RelaxedFlow
+{
+    int sourceIndex; // -1 if the flow comes from a balance pool
+    int balancePoolIndex; // -1 if the flow comes from a source
+    int requirementIndex;
+    int fromMonth;
+    int toMonth; // Exclusive
+    int amount;
+};
+
+// Solves the monthly relaxation of the allocation problem, in which the amount that a source gives
+// to a requirement can be different in every month, and each balance pool is a capacity that is
+// available in every month (rather than a budget that is shared across all months).
+// Each month is then a separate min-cost transportation problem between the sources and the
+// requirements that are active in that month, and every range of months with the same active
+// sources and requirements has the same problem, so we solve it once per range of months.
+// Returns the cost of the relaxed solution. If balance pools are included then this is a lower
+// bound on the fitness of every feasible solution.
+// NOTE: If flows is not null then it is filled with every non-zero flow in the relaxed solution
+double solveMonthlyRelaxation(InputData& input, bool includeBalancePools,
+                              std::vector<RelaxedFlow>* flows);
+
+#endif // _FLOW_H
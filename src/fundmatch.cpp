@@ -5,7 +5,6 @@
 #include <float.h>
 
 #include <vector>
-#include <random>
 #include <algorithm>
 
 #include "fundmatch.h"
@@ -16,15 +15,19 @@ static const int START_DATE_OFFSET = 0;
 static const int TENOR_OFFSET = 1;
 static const int AMOUNT_OFFSET = 2;
 
-InputData g_input;
+ProblemInstance::ProblemInstance()
+    : options(), lowerBound(-FLT_MAX)
+{
+}
 
 Vector::Vector()
-    : dimensions(0), coords(nullptr), constraintViolation(FLT_MAX), fitness(FLT_MAX)
+    : dimensions(0), coords(nullptr), ownsCoords(true),
+        constraintViolation(FLT_MAX), fitness(FLT_MAX)
 {
 }
 
 Vector::Vector(int dimCount)
-    : dimensions(dimCount), constraintViolation(FLT_MAX), fitness(FLT_MAX)
+    : dimensions(dimCount), ownsCoords(true), constraintViolation(FLT_MAX), fitness(FLT_MAX)
 {
     if(this->dimensions > 0)
         this->coords = new float[this->dimensions];
@@ -32,9 +35,15 @@ Vector::Vector(int dimCount)
         this->coords = nullptr;
 }
 
+Vector::Vector(int dimCount, float* externalCoords)
+    : dimensions(dimCount), coords(externalCoords), ownsCoords(false),
+        constraintViolation(FLT_MAX), fitness(FLT_MAX)
+{
+}
+
 Vector::Vector(const Vector& other)
-    : dimensions(other.dimensions), constraintViolation(other.constraintViolation),
-        fitness(other.fitness)
+    : dimensions(other.dimensions), ownsCoords(true),
+        constraintViolation(other.constraintViolation), fitness(other.fitness)
 {
     if(this->dimensions > 0)
     {
@@ -49,17 +58,17 @@ Vector::Vector(const Vector& other)
 
 Vector::~Vector()
 {
-    if(this->coords)
+    if(this->coords && this->ownsCoords)
     {
         delete[] this->coords;
     }
 }
 
-void Vector::processPositionUpdate(int allocCount, AllocationPointer* allocations)
+void Vector::processPositionUpdate(ProblemInstance& problem)
 {
-    this->constraintViolation = measureConstraintViolation(*this, allocCount, allocations);
+    this->constraintViolation = measureConstraintViolation(*this, problem);
     if(this->constraintViolation == 0.0f)
-        this->fitness = computeFitness(*this, allocCount, allocations);
+        this->fitness = computeFitness(*this, problem);
     else
         this->fitness = FLT_MAX;
 }
@@ -69,6 +78,7 @@ Vector& Vector::operator =(const Vector& other)
     // NOTE: We only need to delete/reallocate memory if the size has changed
     if(this->dimensions != other.dimensions)
     {
+        assert(this->ownsCoords); // We can't resize memory that we don't own
         if(this->coords)
             delete[] this->coords;
         this->coords = new float[other.dimensions];
@@ -116,13 +126,13 @@ void AllocationPointer::setAmount(Vector& data, float value)
     data[this->allocStartDimension + AMOUNT_OFFSET] = value;
 }
 
-float AllocationPointer::getMinStartDate() const
+float AllocationPointer::getMinStartDate(const InputData& input) const
 {
-    RequirementInfo& req = g_input.requirements[this->requirementIndex];
+    const RequirementInfo& req = input.requirements[this->requirementIndex];
     float result = (float)req.startDate;
     if(this->sourceIndex >= 0)
     {
-        SourceInfo& source = g_input.sources[this->sourceIndex];
+        const SourceInfo& source = input.sources[this->sourceIndex];
         result = max(result, (float)source.startDate);
     }
     // NOTE: If this allocation comes from a balance pool then the start date is determined
@@ -130,13 +140,13 @@ float AllocationPointer::getMinStartDate() const
     return result;
 }
 
-float AllocationPointer::getMaxStartDate() const
+float AllocationPointer::getMaxStartDate(const InputData& input) const
 {
-    RequirementInfo& req = g_input.requirements[this->requirementIndex];
+    const RequirementInfo& req = input.requirements[this->requirementIndex];
     float result = (float)(req.startDate + req.tenor - 1);
     if(this->sourceIndex >= 0)
     {
-        SourceInfo& source = g_input.sources[this->sourceIndex];
+        const SourceInfo& source = input.sources[this->sourceIndex];
         result = min(result, (float)(source.startDate + source.tenor - 1));
     }
     // NOTE: If this allocation comes from a balance pool then the start date is determined
@@ -144,13 +154,13 @@ float AllocationPointer::getMaxStartDate() const
     return result;
 }
 
-float AllocationPointer::getMaxTenor(const Vector& data) const
+float AllocationPointer::getMaxTenor(const InputData& input, const Vector& data) const
 {
-    RequirementInfo& req = g_input.requirements[this->requirementIndex];
+    const RequirementInfo& req = input.requirements[this->requirementIndex];
     float result = (float)req.tenor;
     if(this->sourceIndex >= 0)
     {
-        SourceInfo& src = g_input.sources[this->sourceIndex];
+        const SourceInfo& src = input.sources[this->sourceIndex];
         result = (float)maxAllocationTenor(src, req);
     }
     // NOTE: If this allocation comes from a balance pool then the tenor is determined
@@ -158,54 +168,54 @@ float AllocationPointer::getMaxTenor(const Vector& data) const
     return result;
 }
 
-float AllocationPointer::getMaxAmount(const Vector& data) const
+float AllocationPointer::getMaxAmount(const InputData& input, const Vector& data) const
 {
-    RequirementInfo& req = g_input.requirements[this->requirementIndex];
+    const RequirementInfo& req = input.requirements[this->requirementIndex];
     float result = (float)req.amount;
     if(this->sourceIndex >= 0)
     {
-        SourceInfo& source = g_input.sources[this->sourceIndex];
+        const SourceInfo& source = input.sources[this->sourceIndex];
         result = min(result, (float)source.amount);
     }
     else
     {
-        BalancePoolInfo& pool = g_input.balancePools[this->balancePoolIndex];
+        const BalancePoolInfo& pool = input.balancePools[this->balancePoolIndex];
         result = min(result, (float)pool.amount);
     }
     return result;
 }
 
-void initializeAllocation(AllocationPointer& alloc, Vector& position,
-         mt19937& rng)
+void sortRequirements(InputData& input)
 {
-    uniform_real_distribution<float> uniformf(0.0f, 1.0f);
-
-    int allocSourceIndex = alloc.sourceIndex;
-    int allocBalanceIndex = alloc.balancePoolIndex;
-    assert(((allocSourceIndex == -1) && (allocBalanceIndex >= 0)) ||
-            ((allocSourceIndex >= 0) && (allocBalanceIndex == -1)));
-
-    float minStartDate = alloc.getMinStartDate();
-    float maxStartDate = alloc.getMaxStartDate();
-    float maxTenor = alloc.getMaxTenor(position);
-    float maxAmount = alloc.getMaxAmount(position);
-
-    float dateRange = maxStartDate - minStartDate;
-    assert(dateRange >= 0.0f);
-
-    float startDate = round(minStartDate + (uniformf(rng) * dateRange));
-    assert(startDate > 1.0f);
-    alloc.setStartDate(position, startDate);
-
-    float maxValidStartingTenor = maxStartDate - startDate;
-    float tenor = round(uniformf(rng) * maxValidStartingTenor);
-    alloc.setTenor(position, tenor);
+    input.requirementsByStart.clear();
+    input.requirementsByEnd.clear();
+    for(int i=0; i<input.requirements.size(); i++)
+    {
+        input.requirementsByStart.push_back(i);
+        input.requirementsByEnd.push_back(i);
+    }
 
-    float amount = round(uniformf(rng) * maxAmount);
-    alloc.setAmount(position, amount);
+    auto reqStartDateComparison = [&input](int reqIndexA, int reqIndexB)
+    {
+        int aStart = input.requirements[reqIndexA].startDate;
+        int bStart = input.requirements[reqIndexB].startDate;
+        return aStart < bStart;
+    };
+    auto reqEndDateComparison = [&input](int reqIndexA, int reqIndexB)
+    {
+        int aEnd = input.requirements[reqIndexA].startDate +
+                    input.requirements[reqIndexA].tenor;
+        int bEnd = input.requirements[reqIndexB].startDate +
+                    input.requirements[reqIndexB].tenor;
+        return aEnd < bEnd;
+    };
+    sort(input.requirementsByStart.begin(), input.requirementsByStart.end(),
+            reqStartDateComparison);
+    sort(input.requirementsByEnd.begin(), input.requirementsByEnd.end(),
+            reqEndDateComparison);
 }
 
-int maxAllocationTenor(SourceInfo& source, RequirementInfo& req)
+int maxAllocationTenor(const SourceInfo& source, const RequirementInfo& req)
 {
     int sourceStart = source.startDate;
     int requireStart = req.startDate;
@@ -219,8 +229,12 @@ int maxAllocationTenor(SourceInfo& source, RequirementInfo& req)
     return validEnd - validStart;
 }
 
-float measureConstraintViolation(Vector& position, int allocationCount, AllocationPointer* allocations)
+float measureConstraintViolation(Vector& position, ProblemInstance& problem)
 {
+    InputData& input = problem.input;
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
     float result = 0.0f;
     for(int allocID=0; allocID<allocationCount; allocID++)
     {
@@ -234,7 +248,7 @@ float measureConstraintViolation(Vector& position, int allocationCount, Allocati
         if((allocTenor <= 0.0f) || (allocAmount <= 0.0f))
             continue;
 
-        RequirementInfo& req = g_input.requirements[alloc.requirementIndex];
+        RequirementInfo& req = input.requirements[alloc.requirementIndex];
         float reqStart = (float)req.startDate;
         float reqEnd = (float)(req.startDate + req.tenor);
         float overlapStart = max(allocStart, reqStart);
@@ -245,7 +259,7 @@ float measureConstraintViolation(Vector& position, int allocationCount, Allocati
 
         if(alloc.sourceIndex >= 0)
         {
-            SourceInfo& source = g_input.sources[alloc.sourceIndex];
+            SourceInfo& source = input.sources[alloc.sourceIndex];
             float sourceStart = (float)source.startDate;
             float sourceEnd = (float)(source.startDate + source.tenor);
             float sourceAmount = (float)source.amount;
@@ -259,7 +273,7 @@ float measureConstraintViolation(Vector& position, int allocationCount, Allocati
         else
         {
             assert(alloc.balancePoolIndex >= 0);
-            BalancePoolInfo& balancePool = g_input.balancePools[alloc.balancePoolIndex];
+            BalancePoolInfo& balancePool = input.balancePools[alloc.balancePoolIndex];
             float balanceAmount = (float)balancePool.amount;
             if(allocAmount > balanceAmount)
                 result += allocTenor * (allocAmount - balanceAmount);
@@ -283,17 +297,25 @@ float measureConstraintViolation(Vector& position, int allocationCount, Allocati
     sort(allocationsByStart.begin(), allocationsByStart.end(), allocStartDateComparison);
     sort(allocationsByEnd.begin(), allocationsByEnd.end(), allocEndDateComparison);
 
-    float* sourceValueRemaining = new float[g_input.sources.size()];
-    for(int i=0; i<g_input.sources.size(); i++)
+    float* sourceValueRemaining = new float[input.sources.size()];
+    for(int i=0; i<input.sources.size(); i++)
     {
-        sourceValueRemaining[i] = (float)g_input.sources[i].amount;
+        sourceValueRemaining[i] = (float)input.sources[i].amount;
     }
-    float* balancePoolValueRemaining = new float[g_input.balancePools.size()];
-    for(int i=0; i<g_input.balancePools.size(); i++)
+    float* balancePoolValueRemaining = new float[input.balancePools.size()];
+    for(int i=0; i<input.balancePools.size(); i++)
     {
-        balancePoolValueRemaining[i] = (float)g_input.balancePools[i].amount;
+        balancePoolValueRemaining[i] = (float)input.balancePools[i].amount;
     }
 
+    // NOTE: We compare the end date with the start date here (rather than just checking the tenor)
+    //       because a tiny tenor can vanish entirely when added to the start date
+    auto isEmptyAllocation = [&position](AllocationPointer* alloc)
+    {
+        return (alloc->getEndDate(position) <= alloc->getStartDate(position)) ||
+                (alloc->getAmount(position) <= 0.0f);
+    };
+
     int allocStartIndex = 0;
     int allocEndIndex = 0;
     vector<AllocationPointer*> activeAllocations;
@@ -307,12 +329,12 @@ float measureConstraintViolation(Vector& position, int allocationCount, Allocati
             nextAllocEndTime = allocationsByEnd[allocEndIndex]->getEndDate(position);
 
         // Handle the allocation event
-        // NOTE: It is significant that this is a strict inequality, because for very small
-        //       tenor, we still want to handle the allocation start first
-        if(nextAllocEndTime < nextAllocStartTime)
+        // NOTE: Allocations cover the half-open interval [start, end), so an allocation that ends
+        //       at the same time as another one starts does not overlap with it. Empty
+        //       allocations are never activated, so this cannot end an allocation before it starts
+        if(nextAllocEndTime <= nextAllocStartTime)
         {
-            AllocationPointer& oldAlloc = *allocationsByEnd[allocEndIndex];
-            if(oldAlloc.getTenor(position) < 0.0f)
+            if(isEmptyAllocation(allocationsByEnd[allocEndIndex]))
             {
                 allocEndIndex++;
                 continue;
@@ -349,7 +371,7 @@ float measureConstraintViolation(Vector& position, int allocationCount, Allocati
             // Handle the allocation-start event
             AllocationPointer* alloc = allocationsByStart[allocStartIndex];
             allocStartIndex++;
-            if(alloc->getTenor(position) < 0.0f)
+            if(isEmptyAllocation(alloc))
                 continue;
             activeAllocations.push_back(alloc);
             float allocTenor = alloc->getTenor(position);
@@ -376,8 +398,7 @@ float measureConstraintViolation(Vector& position, int allocationCount, Allocati
     return result;
 }
 
-bool isPositionBetter(Vector& newPosition, Vector& testPosition,
-                      int allocationCount, AllocationPointer* allocations)
+bool isPositionBetter(Vector& newPosition, Vector& testPosition)
 {
     float newViolation = newPosition.constraintViolation;
     float testViolation = testPosition.constraintViolation;
@@ -402,14 +423,18 @@ bool isPositionBetter(Vector& newPosition, Vector& testPosition,
     }
 }
 
-bool isFeasible(Vector& position, int allocationCount, AllocationPointer* allocations)
+bool isFeasible(Vector& position, ProblemInstance& problem)
 {
-    float violation = measureConstraintViolation(position, allocationCount, allocations);
+    float violation = measureConstraintViolation(position, problem);
     return (violation == 0.0f);
 }
 
-float computeFitness(Vector& position, int allocationCount, AllocationPointer* allocations)
+float computeFitness(Vector& position, ProblemInstance& problem)
 {
+    InputData& input = problem.input;
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
     vector<AllocationPointer*> allocationsByStart;
     for(int i=0; i<allocationCount; i++)
         allocationsByStart.push_back(&allocations[i]);
@@ -426,15 +451,15 @@ float computeFitness(Vector& position, int allocationCount, AllocationPointer* a
     sort(allocationsByStart.begin(), allocationsByStart.end(), allocStartDateComparison);
     sort(allocationsByEnd.begin(), allocationsByEnd.end(), allocEndDateComparison);
 
-    float* requirementValueRemaining = new float[g_input.requirements.size()];
-    for(int i=0; i<g_input.requirements.size(); i++)
-        requirementValueRemaining[i] = (float)g_input.requirements[i].amount;
-    bool* requirementActive = new bool[g_input.requirements.size()];
-    for(int i=0; i<g_input.requirements.size(); i++)
+    float* requirementValueRemaining = new float[input.requirements.size()];
+    for(int i=0; i<input.requirements.size(); i++)
+        requirementValueRemaining[i] = (float)input.requirements[i].amount;
+    bool* requirementActive = new bool[input.requirements.size()];
+    for(int i=0; i<input.requirements.size(); i++)
         requirementActive[i] = false;
 
     float firstAllocationTime = allocationsByStart[0]->getStartDate(position);
-    float firstRequirementTime = (float)g_input.requirements[g_input.requirementsByStart[0]].startDate;
+    float firstRequirementTime = (float)input.requirements[input.requirementsByStart[0]].startDate;
 
     float result = 0.0f;
     float currentTime = min(firstAllocationTime, firstRequirementTime);
@@ -444,7 +469,7 @@ float computeFitness(Vector& position, int allocationCount, AllocationPointer* a
     int reqEndIndex = 0;
     vector<AllocationPointer*> activeAllocations;
     while((allocStartIndex < allocationCount) || (allocEndIndex < allocationCount) ||
-          (reqStartIndex < g_input.requirements.size()) || (reqEndIndex < g_input.requirements.size()))
+          (reqStartIndex < input.requirements.size()) || (reqEndIndex < input.requirements.size()))
     {
         float nextAllocStartTime = FLT_MAX;
         float nextAllocEndTime = FLT_MAX;
@@ -455,14 +480,14 @@ float computeFitness(Vector& position, int allocationCount, AllocationPointer* a
         if(allocEndIndex < allocationCount)
             nextAllocEndTime = allocationsByEnd[allocEndIndex]->getEndDate(position);
 
-        if(reqStartIndex < g_input.requirements.size())
+        if(reqStartIndex < input.requirements.size())
         {
-            RequirementInfo& req = g_input.requirements[g_input.requirementsByStart[reqStartIndex]];
+            RequirementInfo& req = input.requirements[input.requirementsByStart[reqStartIndex]];
             nextReqStartTime = (float)req.startDate;
         }
-        if(reqEndIndex < g_input.requirements.size())
+        if(reqEndIndex < input.requirements.size())
         {
-            RequirementInfo& req = g_input.requirements[g_input.requirementsByEnd[reqEndIndex]];
+            RequirementInfo& req = input.requirements[input.requirementsByEnd[reqEndIndex]];
             nextReqEndTime = (float)req.startDate + (float)req.tenor;
         }
 
@@ -479,13 +504,13 @@ float computeFitness(Vector& position, int allocationCount, AllocationPointer* a
             AllocationPointer* activeAlloc = activeAllocations[j];
             float interestRate = BALANCEPOOL_INTEREST_RATE;
             if(activeAlloc->sourceIndex != -1)
-                interestRate = g_input.sources[activeAlloc->sourceIndex].interestRate;
+                interestRate = input.sources[activeAlloc->sourceIndex].interestRate;
 
             result += timeElapsed * activeAlloc->getAmount(position) * interestRate;
         }
 
         // Add the cost of the unsatisfied requirements (IE the cost to satisfy them via RCF)
-        for(int reqID=0; reqID<g_input.requirements.size(); reqID++)
+        for(int reqID=0; reqID<input.requirements.size(); reqID++)
         {
             if(requirementActive[reqID] && (requirementValueRemaining[reqID] > 0.0f))
                 result += timeElapsed * requirementValueRemaining[reqID] * RCF_INTEREST_RATE;
@@ -498,14 +523,14 @@ float computeFitness(Vector& position, int allocationCount, AllocationPointer* a
             if(nextReqEndTime <= nextReqStartTime)
             {
                 // Handle the requirement-end event
-                int reqIndex = g_input.requirementsByEnd[reqEndIndex];
+                int reqIndex = input.requirementsByEnd[reqEndIndex];
                 requirementActive[reqIndex] = false;
                 reqEndIndex++;
             }
             else
             {
                 // Handle the requirement-start event
-                int reqIndex = g_input.requirementsByStart[reqStartIndex];
+                int reqIndex = input.requirementsByStart[reqStartIndex];
                 requirementActive[reqIndex] = true;
                 reqStartIndex++;
             }
@@ -1,8 +1,9 @@
 #ifndef _FUNDMATCH_H
 #define _FUNDMATCH_H
 
+#include <stdint.h>
+
 #include <vector>
-#include <random>
 
 const float RCF_INTEREST_RATE = 0.13f;
 const float BALANCEPOOL_INTEREST_RATE = 0.11f;
@@ -16,6 +17,7 @@ enum class TaxClass
     UPF,
     CF,
 };
+const int TAX_CLASS_COUNT = (int)TaxClass::CF + 1;
 
 // NOTE: startDate values are stored as integers defined as (12*year) +(month-1)
 //       e.g 01/02/2015 = 2015*12 + 1
@@ -55,20 +57,27 @@ struct RequirementInfo
 };
 
 struct AllocationPointer; // Forward-declare so we can use AllocationPointer*'s
+struct InputData;
+struct ProblemInstance;
 struct Vector
 {
     int dimensions;
     float* coords;
+    bool ownsCoords; // False if coords points into memory owned by someone else
 
     float constraintViolation;
     float fitness;
 
     Vector();
     explicit Vector(int dimCount);
+    // Creates a Vector that uses the given coordinate memory rather than allocating its own.
+    // NOTE: The memory must outlive the Vector, and the Vector can never change its size.
+    //       Copies of the Vector allocate their own memory as usual.
+    Vector(int dimCount, float* externalCoords);
     Vector(const Vector& other);
     ~Vector();
 
-    void processPositionUpdate(int allocCount, AllocationPointer* allocations);
+    void processPositionUpdate(ProblemInstance& problem);
 
     Vector& operator =(const Vector& other);
     float& operator [](int index) const;
@@ -90,10 +99,10 @@ struct AllocationPointer
     void setTenor(Vector& data, float value);
     void setAmount(Vector& data, float value);
 
-    float getMinStartDate() const;
-    float getMaxStartDate() const;
-    float getMaxTenor(const Vector& data) const;
-    float getMaxAmount(const Vector& data) const;
+    float getMinStartDate(const InputData& input) const;
+    float getMaxStartDate(const InputData& input) const;
+    float getMaxTenor(const InputData& input, const Vector& data) const;
+    float getMaxAmount(const InputData& input, const Vector& data) const;
 };
 
 struct InputData
@@ -104,26 +113,74 @@ struct InputData
 
     std::vector<int> requirementsByStart;
     std::vector<int> requirementsByEnd;
+
+    // The memory that the strings of the entries above live in (see freeInputStrings)
+    // NOTE: Copies of an input share these, as they share the strings themselves
+    std::vector<char*> stringBlocks;
 };
 
-extern InputData g_input;
+// Fills in the requirementsByStart and requirementsByEnd lists of the given input, from its
+// requirements
+void sortRequirements(InputData& input);
+
+// Options that are given on the command line and apply to every solver
+struct RunOptions
+{
+    uint64_t seed; // The seed from which all random streams are derived
+    float gapTarget; // Stop once within this percentage of the lower bound (0 to never stop early)
+    bool skipPresolve; // If true, solvers are given the full allocation table to work on
+    bool skipDecomposition; // If true, solvers are given every allocation at once
+    bool skipBound; // If true, the lower bound isn't computed, so there is no gap to report or target
+    int topK; // If > 0, only this many of the best sources are initially used for each requirement
+    int horizonMonths; // If > 0, the problem is solved in rolling windows of this many months
+    double deadline; // If > 0, solvers stop searching at this time (see steadyClockSeconds)
+};
 
-// Gives valid initial values to the given position vector, using the given random generators
-void initializeAllocation(AllocationPointer& alloc, Vector& position, std::mt19937& rng);
+// A single problem to solve: the input data, the table of allocations that a solution gives values
+// to, and the options to solve it with.
+// NOTE: Everything that evaluates or solves a problem is given its instance explicitly, and the
+//       solvers never modify it, so any number of instances can be solved at the same time (on
+//       different threads)
+struct ProblemInstance
+{
+    InputData input;
+    std::vector<AllocationPointer> allocations;
+    RunOptions options;
+    float lowerBound; // See computeLowerBound, -FLT_MAX if it hasn't been computed
+
+    // A solution to start the search from, or a Vector with no dimensions to start from scratch.
+    // It doesn't have to be feasible, as the solvers repair it before using it.
+    // NOTE: The GA, PSO and GRASP search around it, while the other solvers build their
+    //       solutions from scratch and ignore it
+    Vector initialSolution;
+
+    ProblemInstance();
+};
 
 // Returns the maximum sensible (and feasible) number of months to allocate from source to req
-int maxAllocationTenor(SourceInfo& source, RequirementInfo& req);
+int maxAllocationTenor(const SourceInfo& source, const RequirementInfo& req);
 
 // Returns a Vector containing the final best solution for the parameters to be optimized
-Vector computeAllocations(int allocationCount, AllocationPointer* allocations);
+Vector computeAllocations(ProblemInstance& problem);
+
+// The name of the solver that computeAllocations uses (which is also the name of its executable)
+extern const char* const SOLVER_NAME;
+
+// True iff computeAllocations spreads its own work across every thread, otherwise it only uses
+// the thread that calls it (and it is safe to call for different problems at once)
+extern const bool SOLVER_IS_PARALLEL;
+
+// True iff computeAllocations is a baseline for the other solvers to be compared to (IE worstcase,
+// which leaves everything to the RCF), so its solution is reported as it is rather than polished
+extern const bool SOLVER_IS_BASELINE;
 
-// Returns true iff the given position vector and allocation set is feasible
-bool isFeasible(Vector& position, int allocationCount, AllocationPointer* allocations);
+// Returns true iff the given position vector is feasible for the given problem
+bool isFeasible(Vector& position, ProblemInstance& problem);
 
-bool isPositionBetter(Vector& newPosition, Vector& testPosition, int allocationCount, AllocationPointer* allocations);
-float measureConstraintViolation(Vector& position, int allocationCount, AllocationPointer* allocations);
+bool isPositionBetter(Vector& newPosition, Vector& testPosition);
+float measureConstraintViolation(Vector& position, ProblemInstance& problem);
 
-// Returns the fitness (total interest cost) of the given position vector and allocation set
-float computeFitness(Vector& position, int allocationCount, AllocationPointer* allocations);
+// Returns the fitness (total interest cost) of the given position vector for the given problem
+float computeFitness(Vector& position, ProblemInstance& problem);
 
 #endif
@@ -1,163 +1,271 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <time.h>
 #include <math.h>
 #include <assert.h>
 #include <float.h>
 
-#include <random>
 #include <vector>
 #include <algorithm>
 
 #include "ga.h"
+#include "bounds.h"
 #include "fundmatch.h"
+#include "ledger.h"
 #include "logging.h"
+#include "parallel.h"
+#include "random.h"
+#include "timing.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 using namespace std;
 
-static FileLogger plotLog = FileLogger("ga_fitness.dat");
-//static minstd_rand randDevice(3);
-static random_device randDevice;
+const char* const SOLVER_NAME = "ga";
+const bool SOLVER_IS_PARALLEL = true;
+const bool SOLVER_IS_BASELINE = false;
 
+static FileLogger plotLog = FileLogger("ga_fitness.dat");
 
-void mutateIndividual(Vector& individual, int allocCount, AllocationPointer* allocations)
+static float sampleFeasibleStartDate(const InputData& input, const AllocationPointer& alloc,
+                                     const CapacityLedger& ledger, float currentStartDate,
+                                     float tenor, float amount, RandomStream& rng)
 {
-    static mt19937 rng(randDevice());
-    uniform_real_distribution<float> uniformf(0.0f, 1.0f);
+    int minStartDate = (int)alloc.getMinStartDate(input);
+    int maxStartDate = min((int)alloc.getMaxStartDate(input),
+                           allocationWindowEnd(input, alloc) - (int)tenor);
 
-    for(int allocID=0; allocID<allocCount; allocID++)
+    vector<int> validStartDates;
+    for(int startDate=minStartDate; startDate<=maxStartDate; startDate++)
     {
-        if(uniformf(rng) > MUTATION_RATE)
-            continue;
+        if(ledger.fits(alloc, (float)startDate, tenor, amount))
+            validStartDates.push_back(startDate);
+    }
+    if(validStartDates.empty())
+        return currentStartDate;
+
+    return (float)validStartDates[rng.uniformInt(0, (int)validStartDates.size()-1)];
+}
 
+// Returns the number of allocations to skip before the next one that gets mutated
+// NOTE: Each allocation is mutated independently with probability MUTATION_RATE, so the number of
+//       allocations between consecutive mutations is geometrically distributed
+static int sampleMutationSkip(RandomStream& rng, int maxSkip)
+{
+    static const float logNoMutationRate = logf(1.0f - MUTATION_RATE);
+    float uniform = 1.0f - rng.uniformf(); // In (0, 1] so that the log is finite
+    float skip = floorf(logf(uniform) / logNoMutationRate);
+    if(skip >= (float)maxSkip)
+        return maxSkip;
+    return (int)skip;
+}
+
+void mutateIndividual(Vector& individual, CapacityLedger& ledger, ProblemInstance& problem,
+                      RandomStream& rng)
+{
+    const InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    // NOTE: We jump straight from one mutated allocation to the next, so that mutation only costs
+    //       time for the (very few) allocations that actually get mutated
+    for(int allocID=sampleMutationSkip(rng, allocCount);
+        allocID<allocCount;
+        allocID+=1+sampleMutationSkip(rng, allocCount))
+    {
+        // NOTE: We take the allocation out of the ledger while we mutate it, so that the ledger
+        //       tells us exactly how much is available to this allocation, and we only ever pick
+        //       new values that keep the individual feasible
         AllocationPointer& alloc = allocations[allocID];
+        ledger.removeAllocation(alloc, individual);
+        float startDate = floorf(alloc.getStartDate(individual));
+        float tenor = alloc.getTenor(individual);
+        float amount = alloc.getAmount(individual);
 #if 1 // Single value mutation
-        float mutationType = uniformf(rng);
+        float mutationType = rng.uniformf();
         if(mutationType < 0.333f)
         {
             // Start Date
-            float minStartDate = alloc.getMinStartDate();
-            float maxStartDate = alloc.getMaxStartDate();
-            float dateRange = maxStartDate - minStartDate;
-            float newStartDate = minStartDate + uniformf(rng)*dateRange;
-            alloc.setStartDate(individual, newStartDate);
+            startDate = sampleFeasibleStartDate(input, alloc, ledger, startDate, tenor, amount,
+                                                rng);
         }
         else if(mutationType < 0.666f)
         {
             // Tenor
-            float maxTenor = alloc.getMaxTenor(individual);
-            float newTenor = round(uniformf(rng)*maxTenor);
-            alloc.setTenor(individual, newTenor);
+            int maxTenor = ledger.maxFeasibleTenor(alloc, (int)startDate, amount);
+            tenor = round(rng.uniformf()*maxTenor);
         }
         else
         {
             // Amount
-            float maxAmount = alloc.getMaxAmount(individual);
-            float newAmount = round(uniformf(rng)*maxAmount);
-            alloc.setAmount(individual, newAmount);
+            int endDate = (int)ceilf(startDate + tenor);
+            float maxAmount = min(alloc.getMaxAmount(input, individual),
+                                  ledger.availableAmount(alloc, (int)startDate, endDate));
+            amount = floorf(rng.uniformf()*maxAmount);
         }
 #endif
 #if 0   // Single allocation mutation
-        float minStartDate = alloc.getMinStartDate();
-        float maxStartDate = alloc.getMaxStartDate();
-        float dateRange = maxStartDate - minStartDate;
-        float newStartDate = minStartDate + uniformf(rng)*dateRange;
-        float maxTenor = alloc.getMaxTenor(individual);
-        float newTenor = round(uniformf(rng)*maxTenor);
-        float maxAmount = alloc.getMaxAmount(individual);
-        float newAmount = round(uniformf(rng)*maxAmount);
-
-        alloc.setStartDate(individual, newStartDate);
-        alloc.setTenor(individual, newTenor);
-        alloc.setAmount(individual, newAmount);
+        startDate = sampleFeasibleStartDate(input, alloc, ledger, startDate, 0.0f, 0.0f, rng);
+        int maxTenor = ledger.maxFeasibleTenor(alloc, (int)startDate, 0.0f);
+        tenor = round(rng.uniformf()*maxTenor);
+        int endDate = (int)startDate + (int)tenor;
+        float maxAmount = min(alloc.getMaxAmount(input, individual),
+                              ledger.availableAmount(alloc, (int)startDate, endDate));
+        amount = floorf(rng.uniformf()*maxAmount);
 #endif
+
+        alloc.setStartDate(individual, startDate);
+        alloc.setTenor(individual, tenor);
+        alloc.setAmount(individual, amount);
+        ledger.addAllocation(alloc, individual);
     }
 }
 
-static void crossoverIndividualAllocation(Vector& indivA, Vector& indivB, AllocationPointer& alloc)
+// Returns the given amount, reduced as far as is necessary for it to fit into the given ledger
+static float fitAmountToLedger(const CapacityLedger& ledger, const AllocationPointer& alloc,
+                               float startDate, float tenor, float amount)
 {
-    float tempStartDate = alloc.getStartDate(indivA);
-    float tempTenor = alloc.getTenor(indivA);
-    float tempAmount = alloc.getAmount(indivA);
-
-    alloc.setStartDate(indivA, alloc.getStartDate(indivB));
-    alloc.setTenor(indivA, alloc.getTenor(indivB));
-    alloc.setAmount(indivA, alloc.getAmount(indivB));
+    if(ledger.fits(alloc, startDate, tenor, amount))
+        return amount;
 
-    alloc.setStartDate(indivB, tempStartDate);
-    alloc.setTenor(indivB, tempTenor);
-    alloc.setAmount(indivB, tempAmount);
+    int startMonth = (int)floorf(startDate);
+    int endMonth = (int)ceilf(startDate + tenor);
+    return floorf(ledger.availableAmount(alloc, startMonth, endMonth));
 }
 
-void crossoverIndividuals(Vector& individualA, Vector& individualB,
-                          int allocationCount, AllocationPointer* allocations)
+static inline int lowestSetBit(uint32_t word)
 {
-    static mt19937 rng(randDevice());
-    uniform_real_distribution<float> uniformf(0.0f, 1.0f);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return (int)index;
+#else
+    return __builtin_ctz(word);
+#endif
+}
 
-    if(uniformf(rng) > CROSSOVER_RATE)
-        return;
+// Calls body(allocID) for every allocation whose bit is set in the given mask, in increasing order
+template<typename Body>
+static void forEachMaskedAllocation(const uint32_t* mask, int allocCount, Body body)
+{
+    int wordCount = (allocCount + 31)/32;
+    for(int wordIndex=0; wordIndex<wordCount; wordIndex++)
+    {
+        uint32_t word = mask[wordIndex];
+        while(word != 0)
+        {
+            int allocID = 32*wordIndex + lowestSetBit(word);
+            if(allocID >= allocCount)
+                return;
+            body(allocID);
+            word &= word - 1;
+        }
+    }
+}
 
-#if 0
-    // Standard crossover (swap one side of a single point)
-    uniform_int_distribution<int> randomAllocation(0, allocationCount-1); // Endpoints are inclusive
-    int middleAllocation = randomAllocation(rng);
-    for(int allocID=0; allocID<middleAllocation; allocID++)
+// Swaps the first count coordinates between the two given arrays, wherever swap is non-zero
+// NOTE: This is a branchless select, so when count is a compile-time constant it gets vectorized
+static inline void selectSwapCoordinates(float* __restrict coordsA, float* __restrict coordsB,
+                                         const int32_t* __restrict swap, int count)
+{
+    for(int dim=0; dim<count; dim++)
     {
-        AllocationPointer& alloc = allocations[allocID];
-        crossoverIndividualAllocation(individualA, individualB, alloc);
+        float valueA = coordsA[dim];
+        float valueB = coordsB[dim];
+        coordsA[dim] = swap[dim] ? valueB : valueA;
+        coordsB[dim] = swap[dim] ? valueA : valueB;
     }
-#endif
+}
 
-#if 0
-    // Interval crossover
-    uniform_int_distribution<int> randomAllocation(0, allocationCount-1);
-    int fromAlloc = randomAllocation(rng);
-    int toAlloc = randomAllocation(rng);
-    int currentAlloc = fromAlloc;
-    while(currentAlloc != toAlloc)
+// Swaps all of the coordinates of every allocation whose bit is set in the given mask, between
+// the two given (distinct) coordinate arrays
+// NOTE: Rather than calling the getters/setters for each value, each word of the mask is expanded
+//       to one select flag per coordinate and all of the coordinates covered by that word are
+//       swapped at once. Words with no bits set are skipped entirely.
+static void swapMaskedCoordinates(float* coordsA, float* coordsB, const uint32_t* mask,
+                                  int allocCount)
+{
+    const int dimsPerWord = 32*DIMENSIONS_PER_ALLOCATION;
+    int32_t dimSwap[dimsPerWord];
+
+    int fullWordCount = allocCount/32;
+    int wordCount = (allocCount + 31)/32;
+    for(int wordIndex=0; wordIndex<wordCount; wordIndex++)
     {
-        AllocationPointer& alloc = allocations[currentAlloc];
-        crossoverIndividualAllocation(individualA, individualB, alloc);
+        uint32_t word = mask[wordIndex];
+        if(word == 0)
+            continue;
+
+        for(int bit=0; bit<32; bit++)
+        {
+            int32_t swap = (int32_t)((word >> bit) & 1);
+            for(int i=0; i<DIMENSIONS_PER_ALLOCATION; i++)
+                dimSwap[bit*DIMENSIONS_PER_ALLOCATION + i] = swap;
+        }
 
-        currentAlloc = (currentAlloc+1)%allocationCount;
+        int firstDim = wordIndex*dimsPerWord;
+        if(wordIndex < fullWordCount)
+        {
+            selectSwapCoordinates(coordsA + firstDim, coordsB + firstDim, dimSwap, dimsPerWord);
+        }
+        else
+        {
+            int dimCount = allocCount*DIMENSIONS_PER_ALLOCATION - firstDim;
+            selectSwapCoordinates(coordsA + firstDim, coordsB + firstDim, dimSwap, dimCount);
+        }
     }
-#endif
+}
+
+// NOTE: crossoverMask must contain one random bit for each allocation, which decides whether or
+//       not that allocation gets swapped (for the crossover types that need it)
+void crossoverIndividuals(Vector& individualA, CapacityLedger& ledgerA,
+                          Vector& individualB, CapacityLedger& ledgerB,
+                          ProblemInstance& problem, const uint32_t* crossoverMask,
+                          RandomStream& rng)
+{
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+    if(rng.uniformf() > CROSSOVER_RATE)
+        return;
 
-#if 1
     // N-point crossover
-    for(int allocID=0; allocID<allocationCount; allocID++)
+    // NOTE: We take every swapped allocation out of both ledgers, swap all of their values at
+    //       once and then put them back. If the values from one individual don't fit into the
+    //       other (because the other is using more of that source elsewhere) then we shrink the
+    //       amount so that crossover never makes an individual infeasible.
+    forEachMaskedAllocation(crossoverMask, allocationCount, [&](int allocID)
     {
-        if(uniformf(rng) > 0.5f)
-            continue;
+        ledgerA.removeAllocation(allocations[allocID], individualA);
+        ledgerB.removeAllocation(allocations[allocID], individualB);
+    });
 
-        AllocationPointer& alloc = allocations[allocID];
-        crossoverIndividualAllocation(individualA, individualB, alloc);
-    }
-#endif
+    swapMaskedCoordinates(individualA.coords, individualB.coords, crossoverMask, allocationCount);
 
-#if 0
-    // Requirement crossover
-    uniform_int_distribution<int> randomReq(0, (int)g_input.requirements.size()-1);
-    int crossedReq = randomReq(rng);
-    for(int allocID=0; allocID<allocationCount; allocID++)
+    forEachMaskedAllocation(crossoverMask, allocationCount, [&](int allocID)
     {
         AllocationPointer& alloc = allocations[allocID];
-        if(alloc.requirementIndex != crossedReq)
-            continue;
-
-        crossoverIndividualAllocation(individualA, individualB, alloc);
-    }
-#endif
+        float newAmountA = fitAmountToLedger(ledgerA, alloc, alloc.getStartDate(individualA),
+                                             alloc.getTenor(individualA),
+                                             alloc.getAmount(individualA));
+        float newAmountB = fitAmountToLedger(ledgerB, alloc, alloc.getStartDate(individualB),
+                                             alloc.getTenor(individualB),
+                                             alloc.getAmount(individualB));
+        alloc.setAmount(individualA, newAmountA);
+        alloc.setAmount(individualB, newAmountB);
+        ledgerA.addAllocation(alloc, individualA);
+        ledgerB.addAllocation(alloc, individualB);
+    });
 }
 
-Vector evolvePopulation(Vector* population, int dimensionCount,
-                        int allocCount, AllocationPointer* allocations)
+Vector evolvePopulation(Vector* population, int dimensionCount, ProblemInstance& problem)
 {
+    int allocCount = (int)problem.allocations.size();
     int bestIndivIndex = 0;
     for(int indivID=1; indivID<POPULATION_SIZE; indivID++)
     {
-        if(isPositionBetter(population[indivID], population[bestIndivIndex],
-                            allocCount, allocations))
+        if(isPositionBetter(population[indivID], population[bestIndivIndex]))
         {
             bestIndivIndex = indivID;
         }
@@ -167,24 +275,28 @@ Vector evolvePopulation(Vector* population, int dimensionCount,
     if(bestIndividual.fitness != FLT_MAX)
         plotLog.log("%d %.2f\n", -1, bestIndividual.fitness);
 
-    mt19937 rng(randDevice());
-    uniform_real_distribution<float> uniformf(0.0f, 1.0f);
-    uniform_int_distribution<int> uniformIndiv(0, POPULATION_SIZE-1); // Inclusive
-    uniform_int_distribution<int> uniformIndivOrBest(-1, POPULATION_SIZE-1);
-
     assert(POPULATION_SIZE % 2 == 0); // So we can do nice crossover
     vector<Vector> parentList(POPULATION_SIZE);
+    vector<CapacityLedger> parentLedgers(POPULATION_SIZE);
 
+    // NOTE: The per-allocation random bits for crossover are generated in bulk at the start of
+    //       each crossover, which is much cheaper than drawing them one at a time
+    int maskWordCount = (allocCount + 31)/32;
+    vector<uint32_t> crossoverMasks((POPULATION_SIZE/2) * maskWordCount);
+
+    // NOTE: Every parent/pair gets its own random stream in every iteration, so the steps below
+    //       can be run in parallel and still give the same result for a given seed
     for(int iteration=0; iteration<MAX_ITERATIONS; iteration++)
     {
         // Parent Selection
-        for(int parentID=0; parentID<POPULATION_SIZE; parentID++)
+        parallelFor(POPULATION_SIZE, [&](int parentID)
         {
+            RandomStream rng(problem.options.seed, StreamPurpose::Selection, iteration, parentID);
             Vector* tourneyWinner = nullptr;
             for(int i=0; i<TOURNAMENT_SIZE; i++)
             {
                 Vector* contestant = nullptr;
-                int contestantID = uniformIndivOrBest(rng);
+                int contestantID = rng.uniformInt(-1, POPULATION_SIZE-1); // Inclusive
                 if(contestantID == -1)
                     contestant = &bestIndividual;
                 else
@@ -195,30 +307,43 @@ Vector evolvePopulation(Vector* population, int dimensionCount,
                 {
                     tourneyWinner = contestant;
                 }
-                else if(isPositionBetter(*contestant, *tourneyWinner, allocCount, allocations))
+                else if(isPositionBetter(*contestant, *tourneyWinner))
                 {
                     tourneyWinner = contestant;
                 }
             }
 
             parentList[parentID] = *tourneyWinner;
-        }
+            parentLedgers[parentID].build(parentList[parentID], problem);
+        });
 
         // Crossover
-        for(int parentID=0; parentID<POPULATION_SIZE; parentID+=2)
+        parallelFor(POPULATION_SIZE/2, [&](int pairID)
         {
-            crossoverIndividuals(parentList[parentID], parentList[parentID+1], allocCount, allocations);
+            int parentID = 2*pairID;
+            RandomStream rng(problem.options.seed, StreamPurpose::Crossover, iteration, pairID);
+            uint32_t* crossoverMask = &crossoverMasks[pairID * maskWordCount];
+            rng.fillBits(crossoverMask, maskWordCount);
+            crossoverIndividuals(parentList[parentID], parentLedgers[parentID],
+                                 parentList[parentID+1], parentLedgers[parentID+1],
+                                 problem, crossoverMask, rng);
             // NOTE: These same Vectors will get updated again during mutation, and thats when
             //       we'll get their new violation/fitness
-        }
+        });
 
         // Mutation
-        for(int parentID=0; parentID<POPULATION_SIZE; parentID++)
+        parallelFor(POPULATION_SIZE, [&](int parentID)
         {
-            mutateIndividual(parentList[parentID], allocCount, allocations);
+            RandomStream rng(problem.options.seed, StreamPurpose::Mutation, iteration, parentID);
+            mutateIndividual(parentList[parentID], parentLedgers[parentID], problem, rng);
 
-            parentList[parentID].processPositionUpdate(allocCount, allocations);
-        }
+            parentList[parentID].processPositionUpdate(problem);
+            if(REPAIR_INFEASIBLE && (parentList[parentID].constraintViolation > 0.0f))
+            {
+                repairPosition(parentList[parentID], parentLedgers[parentID], problem);
+                parentList[parentID].processPositionUpdate(problem);
+            }
+        });
 
         // Child selection
         for(int i=0; i<POPULATION_SIZE; i++)
@@ -229,61 +354,77 @@ Vector evolvePopulation(Vector* population, int dimensionCount,
         // Evaluation
         for(int indivID=0; indivID<POPULATION_SIZE; indivID++)
         {
-            if(isPositionBetter(population[indivID], bestIndividual, allocCount, allocations))
+            if(isPositionBetter(population[indivID], bestIndividual))
             {
                 bestIndividual = population[indivID];
             }
         }
         if(bestIndividual.fitness != FLT_MAX)
             plotLog.log("%d %.2f\n", iteration, bestIndividual.fitness);
+
+        if(hasReachedGapTarget(problem, bestIndividual.fitness))
+        {
+            printf("Reached the gap target after %d iterations\n", iteration+1);
+            break;
+        }
+        if(hasPassedDeadline(problem))
+        {
+            printf("Reached the deadline after %d iterations\n", iteration+1);
+            break;
+        }
     }
 
     return bestIndividual;
 }
 
-Vector computeAllocations(int allocationCount, AllocationPointer* allocations)
+Vector computeAllocations(ProblemInstance& problem)
 {
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
     // Create the swarm
     int dimensionCount = allocationCount * DIMENSIONS_PER_ALLOCATION;
     Vector* population = new Vector[POPULATION_SIZE];
     for(int i=0; i<POPULATION_SIZE; i++)
     {
         population[i] = Vector(dimensionCount);
-        // NOTE: We initialize the values here just so that our initial solution is feasible
-        for(int allocID=0; allocID<allocationCount; allocID++)
-        {
-            float minStartDate = allocations[allocID].getMinStartDate();
-            allocations[allocID].setStartDate(population[i], minStartDate);
-            allocations[allocID].setTenor(population[i], 0.0f);
-            allocations[allocID].setAmount(population[i], 0.0f);
-        }
     }
 
-    // Initialize the swarm
-    mt19937 rng(randDevice());
-    for(int i=0; i<POPULATION_SIZE; i++)
+    // Initialize the population
+    // NOTE: Each individual is built against its own capacity ledger, so every individual is
+    //       feasible from the start and they can all be initialized independently of each other.
+    //       When there is an initial solution, the first seeded individual is a (repaired) copy of
+    //       it and the rest of them are mutated copies, so that they spread out around it.
+    int seededCount = 0;
+    if(problem.initialSolution.dimensions > 0)
+        seededCount = (int)(SEEDED_POPULATION_FRACTION*POPULATION_SIZE);
+    parallelFor(POPULATION_SIZE, [&](int i)
     {
-        int retries = 0;
-        do
+        RandomStream rng(problem.options.seed, StreamPurpose::Initialization, 0, i);
+        CapacityLedger ledger;
+        if((i >= 1) && (i <= seededCount))
         {
-            for(int allocID=0; allocID<allocationCount; allocID++)
-            {
-                initializeAllocation(allocations[allocID], population[i], rng);
-            }
-        } while((retries++ < 5) &&
-                !isFeasible(population[i], allocationCount, allocations));
+            population[i] = problem.initialSolution;
+            repairPosition(population[i], ledger, problem);
+            if(i > 1)
+                mutateIndividual(population[i], ledger, problem, rng);
+        }
+        else
+        {
+            initializeFeasiblePosition(population[i], ledger, problem, rng);
+        }
 
         if(i == 0)
         {
             for(int allocID=0; allocID<allocationCount; allocID++)
                 allocations[allocID].setAmount(population[0], 0.0f);
         }
-        population[i].processPositionUpdate(allocationCount, allocations);
-    }
+        population[i].processPositionUpdate(problem);
+    });
     printf("Initialization complete\n");
 
     // Run the GA on our new population
-    Vector bestSolution = evolvePopulation(population, dimensionCount, allocationCount, allocations);
+    Vector bestSolution = evolvePopulation(population, dimensionCount, problem);
 
     // Cleanup
     delete[] population;
@@ -12,4 +12,10 @@ const float MUTATION_RATE = 1.0f/POPULATION_SIZE;
 const float CROSSOVER_RATE = 0.60f;
 const int TOURNAMENT_SIZE = 75;
 
+// The fraction of the population that starts around the problem's initial solution, if it has one
+const float SEEDED_POPULATION_FRACTION = 0.25f;
+
+// If true, any child that is still infeasible after crossover and mutation is repaired
+const bool REPAIR_INFEASIBLE = true;
+
 #endif
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <assert.h>
+#include <float.h>
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include "grasp.h"
+#include "bounds.h"
+#include "fundmatch.h"
+#include "greedy.h"
+#include "ledger.h"
+#include "logging.h"
+#include "parallel.h"
+#include "polish.h"
+#include "random.h"
+#include "sourceindex.h"
+#include "timing.h"
+
+using namespace std;
+
+const char* const SOLVER_NAME = "grasp";
+const bool SOLVER_IS_PARALLEL = true;
+const bool SOLVER_IS_BASELINE = false;
+
+static FileLogger plotLog = FileLogger("grasp_fitness.dat");
+
+// A candidate for a single requirement in the restricted candidate list
+struct MatchCandidate
+{
+    int sourceIndex; // -1 if this is a balance pool
+    int balancePoolIndex; // -1 if this is a source
+    float saving;
+};
+
+static MatchCandidate makeCandidate(InputData& input, RequirementInfo& req, int srcIndex,
+                                    int poolIndex)
+{
+    MatchCandidate candidate;
+    candidate.sourceIndex = srcIndex;
+    candidate.balancePoolIndex = poolIndex;
+    if(srcIndex >= 0)
+        candidate.saving = estimateSourceSaving(input.sources[srcIndex], req);
+    else
+        candidate.saving = estimateBalancePoolSaving(req);
+    return candidate;
+}
+
+// Matches every requirement (in a random order) to a source or balance pool, picked at random from
+// the restricted candidate list. That is the heuristic's own match for the requirement (see
+// findGreedyMatch), along with every other candidate whose estimated saving is close to that of
+// the best candidate.
+// NOTE: The first construction isn't randomized, so it is exactly the heuristic's matching
+static void constructMatching(ProblemInstance& problem, int constructionIndex,
+                              const SourceIndex& sourcePrototype,
+                              const RequirementCandidates& reqCandidates, GreedyMatching& matching)
+{
+    InputData& input = problem.input;
+    RandomStream rng(problem.options.seed, StreamPurpose::Construction, 0,
+                     (uint32_t)constructionIndex);
+    bool randomize = (constructionIndex > 0);
+
+    int reqCount = (int)input.requirements.size();
+    vector<int> requirementOrder(reqCount);
+    for(int i=0; i<reqCount; i++)
+        requirementOrder[i] = i;
+    if(randomize)
+        shuffle(requirementOrder.begin(), requirementOrder.end(), rng);
+
+    matching.reset(input);
+    SourceIndex unusedSources = sourcePrototype;
+    vector<int> candidateSources;
+    vector<MatchCandidate> candidates;
+    vector<int> balanceRemaining(input.balancePools.size());
+    for(int i=0; i<(int)input.balancePools.size(); i++)
+        balanceRemaining[i] = input.balancePools[i].amount;
+
+    for(int orderIndex=0; orderIndex<reqCount; orderIndex++)
+    {
+        int reqIndex = requirementOrder[orderIndex];
+        RequirementInfo& req = input.requirements[reqIndex];
+
+        // NOTE: We sort the sources so that the candidate order (and hence which one we pick) only
+        //       depends on the random stream and not on the layout of the source index, and so
+        //       that the heuristic's match is the same as in the heuristic itself
+        candidateSources.clear();
+        unusedSources.findOverlappingSources(req, candidateSources);
+        sort(candidateSources.begin(), candidateSources.end());
+        reqCandidates.filterSources(reqIndex, candidateSources);
+        const vector<int>& candidatePools = reqCandidates.balancePools[reqIndex];
+
+        int greedySrcIndex;
+        int greedyPoolIndex;
+        findGreedyMatch(input, req, candidateSources, candidatePools, balanceRemaining,
+                        greedySrcIndex, greedyPoolIndex);
+
+        // NOTE: The heuristic's match always goes first (whatever its saving), and the other
+        //       candidates are only there if they save anything at all
+        candidates.clear();
+        if((greedySrcIndex >= 0) || (greedyPoolIndex >= 0))
+            candidates.push_back(makeCandidate(input, req, greedySrcIndex, greedyPoolIndex));
+        if(randomize)
+        {
+            for(int i=0; i<(int)candidateSources.size(); i++)
+            {
+                if(candidateSources[i] == greedySrcIndex)
+                    continue;
+                MatchCandidate candidate = makeCandidate(input, req, candidateSources[i], -1);
+                if(candidate.saving > 0.0f)
+                    candidates.push_back(candidate);
+            }
+            int poolIndex = findBestBalancePool(req, balanceRemaining, candidatePools);
+            if((poolIndex >= 0) && (poolIndex != greedyPoolIndex))
+            {
+                MatchCandidate candidate = makeCandidate(input, req, -1, poolIndex);
+                if(candidate.saving > 0.0f)
+                    candidates.push_back(candidate);
+            }
+        }
+        if(candidates.empty())
+            continue; // Leave it to the RCF
+
+        float bestSaving = -FLT_MAX;
+        float worstSaving = FLT_MAX;
+        for(int i=0; i<(int)candidates.size(); i++)
+        {
+            bestSaving = max(bestSaving, candidates[i].saving);
+            worstSaving = min(worstSaving, candidates[i].saving);
+        }
+        float threshold = bestSaving - CANDIDATE_LIST_ALPHA*(bestSaving - worstSaving);
+
+        int restrictedCount = 1; // The heuristic's match
+        for(int i=1; i<(int)candidates.size(); i++)
+        {
+            if(candidates[i].saving >= threshold)
+                candidates[restrictedCount++] = candidates[i];
+        }
+        int chosenIndex = (restrictedCount > 1) ? rng.uniformInt(0, restrictedCount-1) : 0;
+        MatchCandidate& chosen = candidates[chosenIndex];
+
+        if(chosen.sourceIndex >= 0)
+        {
+            matching.requirementSources[reqIndex] = chosen.sourceIndex;
+            unusedSources.markUsed(chosen.sourceIndex);
+        }
+        else
+        {
+            matching.requirementBalancePools[reqIndex] = chosen.balancePoolIndex;
+            balanceRemaining[chosen.balancePoolIndex] -= req.amount;
+        }
+    }
+}
+
+Vector computeAllocations(ProblemInstance& problem)
+{
+    int allocationCount = (int)problem.allocations.size();
+    int dimensionCount = allocationCount * DIMENSIONS_PER_ALLOCATION;
+
+    // NOTE: The problem, the source index that every construction starts from and the candidates
+    //       of each requirement are only ever read by the constructions, so all threads share them
+    SourceIndex sourcePrototype;
+    sourcePrototype.build(problem.input);
+    RequirementCandidates reqCandidates;
+    reqCandidates.build(problem);
+
+    mutex bestMutex;
+    Vector bestSolution(dimensionCount);
+    bestSolution.fitness = FLT_MAX;
+    int bestConstructionIndex = -1;
+
+    // NOTE: An initial solution is treated like a construction that comes before all of the
+    //       others, so the constructions have to beat it to replace it
+    atomic<bool> stopSearching(false);
+    if(problem.initialSolution.dimensions > 0)
+    {
+        CapacityLedger ledger;
+        bestSolution = problem.initialSolution;
+        repairPosition(bestSolution, ledger, problem);
+        bestSolution.processPositionUpdate(problem);
+        polishSolution(bestSolution, problem, LOCAL_SEARCH_PASSES);
+        plotLog.log("%d %.2f\n", -1, bestSolution.fitness);
+        if(hasReachedGapTarget(problem, bestSolution.fitness))
+            stopSearching.store(true);
+    }
+    parallelFor(CONSTRUCTION_COUNT, [&](int constructionIndex)
+    {
+        // NOTE: The first construction always runs, so that there is a solution to return
+        if(stopSearching.load() || ((constructionIndex > 0) && hasPassedDeadline(problem)))
+            return;
+
+        GreedyMatching matching;
+        constructMatching(problem, constructionIndex, sourcePrototype, reqCandidates, matching);
+
+        Vector solution(dimensionCount);
+        applyMatching(matching, solution, problem);
+        solution.processPositionUpdate(problem);
+        assert(solution.constraintViolation == 0.0f);
+        polishSolution(solution, problem, LOCAL_SEARCH_PASSES);
+
+        // NOTE: Ties go to the earliest construction, so that the result doesn't depend on the
+        //       order in which the threads finish
+        lock_guard<mutex> lock(bestMutex);
+        if((solution.fitness < bestSolution.fitness) ||
+           ((solution.fitness == bestSolution.fitness) &&
+            (constructionIndex < bestConstructionIndex)))
+        {
+            bestSolution = solution;
+            bestConstructionIndex = constructionIndex;
+            plotLog.log("%d %.2f\n", constructionIndex, solution.fitness);
+            if(hasReachedGapTarget(problem, solution.fitness))
+                stopSearching.store(true);
+        }
+    });
+
+    if(bestConstructionIndex < 0)
+        printf("Best solution came from the initial solution\n");
+    else
+        printf("Best solution came from construction %d of %d\n",
+               bestConstructionIndex, CONSTRUCTION_COUNT);
+    assert(isFeasible(bestSolution, problem));
+    return bestSolution;
+}
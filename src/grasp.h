@@ -0,0 +1,18 @@
+#ifndef _GRASP_H
+#define _GRASP_H
+
+#include "fundmatch.h"
+
+// The number of randomized greedy constructions, each of which is followed by a local search
+const int CONSTRUCTION_COUNT = 2000;
+
+// The restricted candidate list for each requirement contains the heuristic's match, along with
+// every other candidate whose estimated saving is within this fraction of the range of savings
+// from the best candidate's saving.
+// 0 only adds the candidates with the best saving, 1 picks uniformly from all of the candidates.
+const float CANDIDATE_LIST_ALPHA = 0.3f;
+
+// The maximum number of polish passes that are used as the local search after each construction
+const int LOCAL_SEARCH_PASSES = 3;
+
+#endif
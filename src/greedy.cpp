@@ -0,0 +1,209 @@
+#include <assert.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "greedy.h"
+
+using namespace std;
+
+void GreedyMatching::reset(const InputData& input)
+{
+    requirementSources.assign(input.requirements.size(), -1);
+    requirementBalancePools.assign(input.requirements.size(), -1);
+}
+
+void RequirementCandidates::build(const ProblemInstance& problem)
+{
+    int reqCount = (int)problem.input.requirements.size();
+    sources.assign(reqCount, vector<int>());
+    balancePools.assign(reqCount, vector<int>());
+    for(int allocIndex=0; allocIndex<(int)problem.allocations.size(); allocIndex++)
+    {
+        const AllocationPointer& alloc = problem.allocations[allocIndex];
+        if(alloc.sourceIndex >= 0)
+            sources[alloc.requirementIndex].push_back(alloc.sourceIndex);
+        else
+            balancePools[alloc.requirementIndex].push_back(alloc.balancePoolIndex);
+    }
+    for(int reqIndex=0; reqIndex<reqCount; reqIndex++)
+    {
+        sort(sources[reqIndex].begin(), sources[reqIndex].end());
+        sort(balancePools[reqIndex].begin(), balancePools[reqIndex].end());
+    }
+}
+
+void RequirementCandidates::filterSources(int reqIndex, vector<int>& candidateSources) const
+{
+    const vector<int>& reqSources = sources[reqIndex];
+    int keptCount = 0;
+    for(int i=0; i<(int)candidateSources.size(); i++)
+    {
+        if(binary_search(reqSources.begin(), reqSources.end(), candidateSources[i]))
+            candidateSources[keptCount++] = candidateSources[i];
+    }
+    candidateSources.resize(keptCount);
+}
+
+bool isBetterSourceMatch(SourceInfo& src, SourceInfo& bestSrc, RequirementInfo& req)
+{
+    // Check how much better the new source would be in terms of:
+    // Tenor (can you allocate for the entire requirement duration? Are we closer to that?)
+    bool tenorImprovement = false;
+    int maxTenor = maxAllocationTenor(src, req);
+    int bestMaxTenor = maxAllocationTenor(bestSrc, req);
+    if(((maxTenor < req.tenor) && (maxTenor > bestMaxTenor)) ||
+        ((maxTenor >= req.tenor) && (maxTenor < bestMaxTenor)))
+        tenorImprovement = true;
+
+    // Amount (can you allocate the full value? Are we closer to that?)
+    bool amountImprovement = false;
+    if(((src.amount < req.amount) && (src.amount > bestSrc.amount)) ||
+            ((src.amount >= req.amount) && (src.amount < bestSrc.amount)))
+        amountImprovement = true;
+
+    return tenorImprovement && amountImprovement;
+}
+
+int findBestBalancePool(RequirementInfo& req, const vector<int>& balanceRemaining,
+                        const vector<int>& candidatePools)
+{
+    // NOTE: There are only ever a handful of balance pools, so we just check all of them
+    int bestPoolIndex = -1;
+    for(int candidateIndex=0; candidateIndex<(int)candidatePools.size(); candidateIndex++)
+    {
+        int poolIndex = candidatePools[candidateIndex];
+        if(bestPoolIndex == -1)
+        {
+            bestPoolIndex = poolIndex;
+            continue;
+        }
+
+        bool isFullySatisfied = (balanceRemaining[poolIndex] >= req.amount);
+        bool wasFullySatisfied = (balanceRemaining[bestPoolIndex] < req.amount);
+        bool nowSmaller = (balanceRemaining[poolIndex] < balanceRemaining[bestPoolIndex]);
+
+        if((isFullySatisfied && !wasFullySatisfied) ||
+                (isFullySatisfied && wasFullySatisfied && nowSmaller) ||
+                (!isFullySatisfied && !wasFullySatisfied && !nowSmaller))
+        {
+            bestPoolIndex = poolIndex;
+        }
+    }
+
+    if((bestPoolIndex >= 0) && (balanceRemaining[bestPoolIndex] < req.amount))
+        bestPoolIndex = -1;
+    return bestPoolIndex;
+}
+
+bool prefersBalancePool(InputData& input, RequirementInfo& req, int srcIndex, int poolIndex)
+{
+    // NOTE: We use the factor of 0.9 here as an approximate means of taking into consideration
+    //       the fact that balance pools have higher interest than most sources, so it is
+    //       likely to be cheaper in many cases to use the source and not the pool, even though
+    //       the source doesn't quite cover the requirement (and then letting the RCF do that)
+    return (poolIndex >= 0) &&
+           ((srcIndex == -1) ||
+            (input.sources[srcIndex].amount < (int)(req.amount*0.9f)) ||
+            (input.sources[srcIndex].tenor < (int)(req.tenor*0.9f)));
+}
+
+void findGreedyMatch(InputData& input, RequirementInfo& req, const vector<int>& candidateSources,
+                     const vector<int>& candidatePools, const vector<int>& balanceRemaining,
+                     int& srcIndex, int& poolIndex)
+{
+    int bestSrcIndex = -1;
+    for(int candidateIndex=0; candidateIndex<(int)candidateSources.size(); candidateIndex++)
+    {
+        int candidateSrcIndex = candidateSources[candidateIndex];
+        if((bestSrcIndex == -1) || // The first one is obviously the best so far
+           isBetterSourceMatch(input.sources[candidateSrcIndex], input.sources[bestSrcIndex], req))
+        {
+            bestSrcIndex = candidateSrcIndex;
+        }
+    }
+
+    int bestPoolIndex = findBestBalancePool(req, balanceRemaining, candidatePools);
+    if(prefersBalancePool(input, req, bestSrcIndex, bestPoolIndex))
+    {
+        srcIndex = -1;
+        poolIndex = bestPoolIndex;
+    }
+    else
+    {
+        srcIndex = bestSrcIndex;
+        poolIndex = -1;
+    }
+}
+
+float estimateSourceSaving(SourceInfo& src, RequirementInfo& req)
+{
+    int tenor = maxAllocationTenor(src, req);
+    int amount = min(src.amount, req.amount);
+    return (RCF_INTEREST_RATE - src.interestRate) * (float)amount * (float)tenor;
+}
+
+float estimateBalancePoolSaving(RequirementInfo& req)
+{
+    return (RCF_INTEREST_RATE - BALANCEPOOL_INTEREST_RATE) * (float)req.amount * (float)req.tenor;
+}
+
+void applyMatching(const GreedyMatching& matching, Vector& solution, ProblemInstance& problem)
+{
+    InputData& input = problem.input;
+    int appliedCount = 0;
+    for(int allocIndex=0; allocIndex<(int)problem.allocations.size(); allocIndex++)
+    {
+        AllocationPointer& alloc = problem.allocations[allocIndex];
+        int reqIndex = alloc.requirementIndex;
+        int srcIndex = alloc.sourceIndex;
+        int poolIndex = alloc.balancePoolIndex;
+
+        if((matching.requirementSources[reqIndex] >= 0) &&
+           (matching.requirementSources[reqIndex] == srcIndex))
+        {
+            SourceInfo& src = input.sources[srcIndex];
+            RequirementInfo& req = input.requirements[reqIndex];
+            int allocStart = max(src.startDate, req.startDate);
+            int allocTenor = maxAllocationTenor(src, req);
+            int allocAmount = min(src.amount, req.amount);
+            assert(allocStart > 0);
+            assert(allocTenor > 0);
+            assert(allocAmount > 0);
+            appliedCount++;
+
+            alloc.setStartDate(solution, (float)allocStart);
+            alloc.setTenor(solution, (float)allocTenor);
+            alloc.setAmount(solution, (float)allocAmount);
+        }
+        else if((matching.requirementBalancePools[reqIndex] >= 0) &&
+                (matching.requirementBalancePools[reqIndex] == poolIndex))
+        {
+            RequirementInfo& req = input.requirements[reqIndex];
+            appliedCount++;
+
+            alloc.setStartDate(solution, (float)req.startDate);
+            alloc.setTenor(solution, (float)req.tenor);
+            alloc.setAmount(solution, (float)req.amount); // NOTE: As above, we need the full amount
+        }
+        else
+        {
+            // Use the RCF
+            alloc.setStartDate(solution, 0);
+            alloc.setTenor(solution, 0);
+            alloc.setAmount(solution, 0);
+        }
+    }
+
+    // NOTE: A matched pair without an allocation would silently be left to the RCF
+    int matchedCount = 0;
+    for(int reqIndex=0; reqIndex<(int)input.requirements.size(); reqIndex++)
+    {
+        if((matching.requirementSources[reqIndex] >= 0) ||
+           (matching.requirementBalancePools[reqIndex] >= 0))
+        {
+            matchedCount++;
+        }
+    }
+    assert(appliedCount == matchedCount);
+}
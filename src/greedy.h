@@ -0,0 +1,69 @@
+#ifndef _GREEDY_H
+#define _GREEDY_H
+
+#include <vector>
+
+#include "fundmatch.h"
+
+// The source and/or balance pool that a greedy construction has matched to each requirement
+struct GreedyMatching
+{
+    std::vector<int> requirementSources; // The matched source of each requirement, or -1
+    std::vector<int> requirementBalancePools; // The matched balance pool of each requirement, or -1
+
+    // Clears the matching so that every requirement of the given input is left to the RCF
+    void reset(const InputData& input);
+};
+
+// The sources and balance pools that each requirement has an allocation from in a problem's
+// allocation table, each in increasing order. A matching can only use these, since applyMatching
+// has nowhere to put any other pair (IE when only the best few sources of each requirement are
+// candidates, or after presolve has removed some allocations).
+struct RequirementCandidates
+{
+    std::vector<std::vector<int>> sources;
+    std::vector<std::vector<int>> balancePools;
+
+    void build(const ProblemInstance& problem);
+
+    // Removes every source that the given requirement has no allocation from from candidateSources,
+    // keeping the rest in the same order
+    void filterSources(int reqIndex, std::vector<int>& candidateSources) const;
+};
+
+// Returns true iff src is a better match for req than bestSrc in terms of both tenor and amount
+// (IE it either covers more of the requirement, or covers all of it while wasting less)
+bool isBetterSourceMatch(SourceInfo& src, SourceInfo& bestSrc, RequirementInfo& req);
+
+// Returns the one of the given balance pools that best matches req given the remaining budget of
+// every pool, or -1 if none of them can fully satisfy the requirement
+// NOTE: We only ever use a balance pool for the full amount of a requirement, so that the
+//       allocation we set from the matching is guaranteed to be feasible
+int findBestBalancePool(RequirementInfo& req, const std::vector<int>& balanceRemaining,
+                        const std::vector<int>& candidatePools);
+
+// Returns true iff the given balance pool should be used for req rather than the given source of
+// input (which may be -1 if there is no matching source)
+bool prefersBalancePool(InputData& input, RequirementInfo& req, int srcIndex, int poolIndex);
+
+// Finds what the heuristic matches to req: the best of the given unused sources (compared in the
+// order given, with isBetterSourceMatch), unless the best of the given balance pools is preferred
+// over it (see prefersBalancePool). Sets srcIndex or poolIndex to the match and the other one to -1 (or both
+// to -1 if there is nothing to match, in which case req is left to the RCF).
+void findGreedyMatch(InputData& input, RequirementInfo& req,
+                     const std::vector<int>& candidateSources,
+                     const std::vector<int>& candidatePools,
+                     const std::vector<int>& balanceRemaining, int& srcIndex, int& poolIndex);
+
+// Returns an estimate of how much would be saved (compared to the RCF) by allocating as much as
+// possible from the given source/a balance pool to req
+float estimateSourceSaving(SourceInfo& src, RequirementInfo& req);
+float estimateBalancePoolSaving(RequirementInfo& req);
+
+// Sets every allocation in solution from the given matching: matched sources give as much as they
+// can over their overlap with the requirement, matched balance pools give the full requirement and
+// every other allocation is left empty
+// NOTE: Every matched pair must have an allocation in the table (see RequirementCandidates)
+void applyMatching(const GreedyMatching& matching, Vector& solution, ProblemInstance& problem);
+
+#endif // _GREEDY_H
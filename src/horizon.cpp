@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <limits.h>
+#include <float.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "horizon.h"
+#include "fundmatch.h"
+#include "ledger.h"
+#include "presolve.h"
+
+using namespace std;
+
+Vector solveRollingHorizon(ProblemInstance& problem, AllocationSolver solve)
+{
+    InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+    int poolCount = (int)input.balancePools.size();
+    int windowMonths = problem.options.horizonMonths;
+    int commitMonths = max(windowMonths/2, 1);
+    if((windowMonths <= 0) || (allocCount == 0))
+        return solve(problem);
+
+    // NOTE: Allocations are visited in order of the start date of their requirement, so every
+    //       window (and its committed part) is a contiguous range of this order
+    vector<int> allocOrder(allocCount);
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+        allocOrder[allocIndex] = allocIndex;
+    stable_sort(allocOrder.begin(), allocOrder.end(), [&input, allocations](int a, int b)
+    {
+        return input.requirements[allocations[a].requirementIndex].startDate <
+               input.requirements[allocations[b].requirementIndex].startDate;
+    });
+    auto requirementStart = [&input, allocations, &allocOrder](int orderIndex)
+    {
+        return input.requirements[allocations[allocOrder[orderIndex]].requirementIndex].startDate;
+    };
+
+    int firstMonth = requirementStart(0);
+    int lastMonth = requirementStart(allocCount-1);
+    if(lastMonth - firstMonth < windowMonths)
+        return solve(problem);
+
+    Vector result(allocCount * DIMENSIONS_PER_ALLOCATION);
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        alloc.setStartDate(result, alloc.getMinStartDate(input));
+        alloc.setTenor(result, 0.0f);
+        alloc.setAmount(result, 0.0f);
+    }
+
+    CapacityLedger committed;
+    committed.reset(input);
+    vector<float> sourceRemaining(input.sources.size(), FLT_MAX);
+
+    int windowCount = 0;
+    int commitBegin = 0;
+    int windowStart = firstMonth;
+    while(commitBegin < allocCount)
+    {
+        // NOTE: Skip over any months in which no (uncommitted) requirement starts
+        windowStart = max(windowStart, requirementStart(commitBegin));
+        int windowEnd = windowStart + windowMonths;
+        int commitEnd = windowStart + commitMonths;
+        if(windowEnd > lastMonth)
+            commitEnd = INT_MAX;
+
+        ReducedProblem window;
+        window.instance.input.balancePools = input.balancePools;
+        for(int poolIndex=0; poolIndex<poolCount; poolIndex++)
+        {
+            float remaining = max(committed.balancePoolRemaining[poolIndex], 0.0f);
+            window.instance.input.balancePools[poolIndex].amount = (int)remaining;
+        }
+
+        // Find what the committed allocations have left of each source in every month that the
+        // window's allocations could use it
+        int windowAllocBegin = commitBegin;
+        int windowAllocEnd = commitBegin;
+        while((windowAllocEnd < allocCount) && (requirementStart(windowAllocEnd) < windowEnd))
+        {
+            AllocationPointer& alloc = allocations[allocOrder[windowAllocEnd]];
+            if(alloc.sourceIndex >= 0)
+            {
+                int fromMonth = (int)alloc.getMinStartDate(input);
+                int toMonth = allocationWindowEnd(input, alloc);
+                float available = committed.availableAmount(alloc, fromMonth, toMonth);
+                sourceRemaining[alloc.sourceIndex] = min(sourceRemaining[alloc.sourceIndex],
+                                                         available);
+            }
+            windowAllocEnd++;
+        }
+
+        // NOTE: Sources that have nothing left are left out of the window entirely, as the solvers
+        //       expect every source to have something to give
+        vector<int> windowOrder;
+        for(int orderIndex=windowAllocBegin; orderIndex<windowAllocEnd; orderIndex++)
+        {
+            int allocIndex = allocOrder[orderIndex];
+            AllocationPointer& alloc = allocations[allocIndex];
+            if((alloc.sourceIndex >= 0) && (sourceRemaining[alloc.sourceIndex] < 1.0f))
+                continue;
+            window.instance.allocations.push_back(alloc);
+            window.originalAllocations.push_back(allocIndex);
+            windowOrder.push_back(orderIndex);
+        }
+        compactProblem(problem, window);
+        window.instance.options.gapTarget = 0.0f;
+
+        int windowAllocCount = (int)window.instance.allocations.size();
+        for(int i=0; i<windowAllocCount; i++)
+        {
+            AllocationPointer& alloc = allocations[window.originalAllocations[i]];
+            if(alloc.sourceIndex < 0)
+                continue;
+            int windowSourceIndex = window.instance.allocations[i].sourceIndex;
+            SourceInfo& source = window.instance.input.sources[windowSourceIndex];
+            source.amount = (int)min((float)source.amount, sourceRemaining[alloc.sourceIndex]);
+        }
+        // NOTE: Reset the sources' remaining amounts for the next window
+        for(int orderIndex=windowAllocBegin; orderIndex<windowAllocEnd; orderIndex++)
+        {
+            AllocationPointer& alloc = allocations[allocOrder[orderIndex]];
+            if(alloc.sourceIndex >= 0)
+                sourceRemaining[alloc.sourceIndex] = FLT_MAX;
+        }
+
+        Vector windowSolution;
+        if(windowAllocCount > 0)
+        {
+            windowSolution = solve(window.instance);
+            windowCount++;
+        }
+
+        // Commit the allocations of every requirement that starts in the committed part
+        // NOTE: Allocations that were left out of the window stay empty
+        for(int i=0; i<windowAllocCount; i++)
+        {
+            if(requirementStart(windowOrder[i]) >= commitEnd)
+                break;
+            AllocationPointer& alloc = allocations[window.originalAllocations[i]];
+            AllocationPointer& windowAlloc = window.instance.allocations[i];
+            alloc.setStartDate(result, windowAlloc.getStartDate(windowSolution));
+            alloc.setTenor(result, windowAlloc.getTenor(windowSolution));
+            alloc.setAmount(result, windowAlloc.getAmount(windowSolution));
+            committed.addAllocation(alloc, result);
+        }
+        while((commitBegin < windowAllocEnd) && (requirementStart(commitBegin) < commitEnd))
+            commitBegin++;
+        windowStart = commitEnd;
+    }
+
+    printf("Solved %d months as %d rolling windows of %d months\n",
+           lastMonth - firstMonth + 1, windowCount, windowMonths);
+    return result;
+}
@@ -0,0 +1,22 @@
+#ifndef _HORIZON_H
+#define _HORIZON_H
+
+#include "fundmatch.h"
+
+// A function that solves the given problem instance
+typedef Vector (*AllocationSolver)(ProblemInstance& problem);
+
+// Solves the given problem as a sequence of overlapping windows of problem.options.horizonMonths
+// months, each of which is solved with the given solver as a problem instance of its own.
+// Only the requirements that start in the first half of a window (its committed part) keep the
+// allocations that were found for them, the rest are solved again as part of the next window,
+// which starts where the committed part ended. The last window commits everything that is left.
+// Committed allocations are carried forward: each later window is only given what is left of every
+// balance pool's budget, and each source is limited to the smallest amount that it has left over
+// the months that the window's allocations could use.
+// Requirements rarely interact with requirements that start years before or after them, so this
+// keeps the size of each solve (and hence the total time) roughly linear in the planning horizon.
+// NOTE: The gap target is ignored by the windows, since the lower bound is for the whole problem
+Vector solveRollingHorizon(ProblemInstance& problem, AllocationSolver solve);
+
+#endif // _HORIZON_H
@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+
+#include "incremental.h"
+#include "fundmatch.h"
+#include "decompose.h"
+#include "ledger.h"
+#include "presolve.h"
+
+using namespace std;
+
+const int MAX_KEY_LENGTH = 128;
+
+static string sourceKey(const SourceInfo& source)
+{
+    char key[MAX_KEY_LENGTH];
+    snprintf(key, MAX_KEY_LENGTH, "%d|%d|%d|%d|%g", source.startDate, source.tenor,
+             source.amount, (int)source.taxClass, source.interestRate);
+    return key;
+}
+
+static string sourceIdentity(const SourceInfo& source)
+{
+    char key[MAX_KEY_LENGTH];
+    snprintf(key, MAX_KEY_LENGTH, "%d|%d", source.startDate, (int)source.taxClass);
+    return key;
+}
+
+static string requirementKey(const RequirementInfo& req)
+{
+    char key[MAX_KEY_LENGTH];
+    snprintf(key, MAX_KEY_LENGTH, "%d|%d|%d|%d", req.startDate, req.tenor, req.amount,
+             (int)req.taxClass);
+    return key;
+}
+
+static string requirementIdentity(const RequirementInfo& req)
+{
+    char key[MAX_KEY_LENGTH];
+    snprintf(key, MAX_KEY_LENGTH, "%d|%d", req.startDate, (int)req.taxClass);
+    return key;
+}
+
+static string balancePoolIdentity(const BalancePoolInfo& pool)
+{
+    return string(pool.segment) + "|" + pool.name;
+}
+
+static string balancePoolKey(const BalancePoolInfo& pool)
+{
+    char key[MAX_KEY_LENGTH];
+    snprintf(key, MAX_KEY_LENGTH, "|%d|%d|%d|%d|%g|%d", pool.recordedDate, pool.recordedAmount,
+             pool.amountLoanedOnRecordedDate, pool.totalAmount, pool.limitPercentage, pool.amount);
+    return balancePoolIdentity(pool) + key;
+}
+
+// Pairs up previous and current entries that have the same key and haven't been paired up yet,
+// in the order that they appear
+template<typename Info, typename KeyFunction>
+static void matchEntries(const vector<Info>& previous, const vector<Info>& current,
+                         KeyFunction makeKey, vector<int>& previousMap, vector<int>& currentMap)
+{
+    // NOTE: The previous entries for each key are listed in reverse, so that we can take them
+    //       from the back in order
+    unordered_map<string, vector<int>> unmatched;
+    for(int prevIndex=(int)previous.size()-1; prevIndex>=0; prevIndex--)
+    {
+        if(previousMap[prevIndex] < 0)
+            unmatched[makeKey(previous[prevIndex])].push_back(prevIndex);
+    }
+
+    for(int index=0; index<(int)current.size(); index++)
+    {
+        if(currentMap[index] >= 0)
+            continue;
+        unordered_map<string, vector<int>>::iterator it = unmatched.find(makeKey(current[index]));
+        if((it == unmatched.end()) || it->second.empty())
+            continue;
+
+        int prevIndex = it->second.back();
+        it->second.pop_back();
+        previousMap[prevIndex] = index;
+        currentMap[index] = prevIndex;
+    }
+}
+
+template<typename Info, typename KeyFunction, typename IdentityFunction>
+static void computeEntryDelta(const vector<Info>& previous, const vector<Info>& current,
+                              KeyFunction makeKey, IdentityFunction makeIdentity,
+                              vector<int>& previousMap, vector<bool>& changed)
+{
+    previousMap.assign(previous.size(), -1);
+    vector<int> currentMap(current.size(), -1);
+    matchEntries(previous, current, makeKey, previousMap, currentMap);
+
+    changed.resize(current.size());
+    for(int index=0; index<(int)current.size(); index++)
+        changed[index] = (currentMap[index] < 0);
+
+    matchEntries(previous, current, makeIdentity, previousMap, currentMap);
+}
+
+void computeInputDelta(const InputData& previous, const InputData& current, InputDelta& delta)
+{
+    computeEntryDelta(previous.sources, current.sources, sourceKey, sourceIdentity,
+                      delta.sourceMap, delta.sourceChanged);
+    computeEntryDelta(previous.balancePools, current.balancePools, balancePoolKey,
+                      balancePoolIdentity, delta.balancePoolMap, delta.balancePoolChanged);
+    computeEntryDelta(previous.requirements, current.requirements, requirementKey,
+                      requirementIdentity, delta.requirementMap, delta.requirementChanged);
+}
+
+// Returns a key that identifies the allocation from the given source or balance pool (which are
+// numbered after the sources) to the given requirement
+static uint64_t allocationKey(const InputData& input, const AllocationPointer& alloc)
+{
+    int fromIndex = alloc.sourceIndex;
+    if(fromIndex < 0)
+        fromIndex = (int)input.sources.size() + alloc.balancePoolIndex;
+    return ((uint64_t)alloc.requirementIndex << 32) | (uint64_t)(uint32_t)fromIndex;
+}
+
+Vector patchSolution(const ProblemInstance& previous, const Vector& previousSolution,
+                     const InputDelta& delta, ProblemInstance& problem,
+                     vector<bool>& affectedRequirements, vector<bool>& affectedSources)
+{
+    InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    unordered_map<uint64_t, int> allocLookup;
+    allocLookup.reserve(allocCount);
+    Vector result(allocCount * DIMENSIONS_PER_ALLOCATION);
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        allocLookup[allocationKey(input, alloc)] = allocIndex;
+        alloc.setStartDate(result, alloc.getMinStartDate(input));
+        alloc.setTenor(result, 0.0f);
+        alloc.setAmount(result, 0.0f);
+    }
+
+    affectedRequirements = delta.requirementChanged;
+    affectedSources = delta.sourceChanged;
+    for(int prevIndex=0; prevIndex<(int)previous.allocations.size(); prevIndex++)
+    {
+        const AllocationPointer& prevAlloc = previous.allocations[prevIndex];
+        if((prevAlloc.getTenor(previousSolution) <= 0.0f) ||
+           (prevAlloc.getAmount(previousSolution) <= 0.0f))
+        {
+            continue;
+        }
+
+        AllocationPointer alloc = prevAlloc;
+        alloc.requirementIndex = delta.requirementMap[prevAlloc.requirementIndex];
+        if(prevAlloc.sourceIndex >= 0)
+            alloc.sourceIndex = delta.sourceMap[prevAlloc.sourceIndex];
+        else
+            alloc.balancePoolIndex = delta.balancePoolMap[prevAlloc.balancePoolIndex];
+
+        // NOTE: What a removed requirement used is now free for the requirements around it
+        if(alloc.requirementIndex < 0)
+        {
+            if(alloc.sourceIndex >= 0)
+                affectedSources[alloc.sourceIndex] = true;
+            continue;
+        }
+
+        bool fromRemoved = (alloc.sourceIndex < 0) && (alloc.balancePoolIndex < 0);
+        if(fromRemoved ||
+           ((alloc.balancePoolIndex >= 0) && delta.balancePoolChanged[alloc.balancePoolIndex]))
+        {
+            affectedRequirements[alloc.requirementIndex] = true;
+        }
+        if(fromRemoved)
+            continue;
+
+        unordered_map<uint64_t, int>::iterator lookupIt =
+            allocLookup.find(allocationKey(input, alloc));
+        if(lookupIt == allocLookup.end())
+        {
+            affectedRequirements[alloc.requirementIndex] = true;
+            continue;
+        }
+
+        AllocationPointer& newAlloc = allocations[lookupIt->second];
+        newAlloc.setStartDate(result, prevAlloc.getStartDate(previousSolution));
+        newAlloc.setTenor(result, prevAlloc.getTenor(previousSolution));
+        newAlloc.setAmount(result, prevAlloc.getAmount(previousSolution));
+    }
+
+    // NOTE: Only the allocations of changed sources and requirements (and of balance pools, whose
+    //       budgets are shared) can be cut back here, and those are all re-optimized anyway
+    CapacityLedger ledger;
+    repairPosition(result, ledger, problem);
+    return result;
+}
+
+bool extractAffectedProblem(const ProblemInstance& problem,
+                            const vector<bool>& affectedRequirements,
+                            const vector<bool>& affectedSources, ReducedProblem& affected)
+{
+    const InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    const AllocationPointer* allocations = problem.allocations.data();
+    int poolCount = (int)input.balancePools.size();
+
+    vector<int> allocComponent;
+    int componentCount = findComponents(problem, allocComponent);
+    vector<bool> componentAffected(componentCount, false);
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        const AllocationPointer& alloc = allocations[allocIndex];
+        if(affectedRequirements[alloc.requirementIndex] ||
+           ((alloc.sourceIndex >= 0) && affectedSources[alloc.sourceIndex]))
+        {
+            componentAffected[allocComponent[allocIndex]] = true;
+        }
+    }
+
+    vector<float> poolUsed(poolCount, 0.0f);
+    affected.instance.allocations.clear();
+    affected.originalAllocations.clear();
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        const AllocationPointer& alloc = allocations[allocIndex];
+        if(componentAffected[allocComponent[allocIndex]])
+        {
+            affected.instance.allocations.push_back(alloc);
+            affected.originalAllocations.push_back(allocIndex);
+        }
+        else if((alloc.balancePoolIndex >= 0) && (alloc.getTenor(problem.initialSolution) > 0.0f))
+        {
+            poolUsed[alloc.balancePoolIndex] += alloc.getAmount(problem.initialSolution);
+        }
+    }
+    int affectedComponentCount = (int)count(componentAffected.begin(), componentAffected.end(),
+                                            true);
+    printf("Re-optimizing %d of %d components (%zd of %d allocations)\n",
+           affectedComponentCount, componentCount, affected.instance.allocations.size(),
+           allocCount);
+    if(affected.instance.allocations.empty())
+        return false;
+
+    affected.instance.input.balancePools = input.balancePools;
+    for(int poolIndex=0; poolIndex<poolCount; poolIndex++)
+    {
+        BalancePoolInfo& pool = affected.instance.input.balancePools[poolIndex];
+        pool.amount = max((int)((float)pool.amount - poolUsed[poolIndex]), 0);
+    }
+    compactProblem(problem, affected);
+
+    // NOTE: The lower bound is for the whole problem, so the subproblem can't use the gap target
+    affected.instance.options.gapTarget = 0.0f;
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef _INCREMENTAL_H
+#define _INCREMENTAL_H
+
+#include <vector>
+
+#include "fundmatch.h"
+#include "presolve.h"
+
+// How the sources, balance pools and requirements of a previous input correspond to those of the
+// current input
+struct InputDelta
+{
+    // For each previous source/balance pool/requirement, the index of the same one in the current
+    // input, or -1 if it has been removed
+    std::vector<int> sourceMap;
+    std::vector<int> balancePoolMap;
+    std::vector<int> requirementMap;
+
+    // For each current source/balance pool/requirement, true iff it has been added or changed
+    std::vector<bool> sourceChanged;
+    std::vector<bool> balancePoolChanged;
+    std::vector<bool> requirementChanged;
+};
+
+// Works out which entries of the previous input became which entries of the current input.
+// Entries are only compared on the fields that writeOutputData includes (see loadOutputData).
+// Entries that are the same in every one of those fields are unchanged. Of the rest, sources and
+// requirements with the same start date and tax class, and balance pools with the same segment and
+// name, are the same entry with changed values. Everything else has been added or removed.
+// NOTE: Where there are several candidates, entries are paired up in the order that they appear
+void computeInputDelta(const InputData& previous, const InputData& current, InputDelta& delta);
+
+// Maps a solution of the previous problem onto the current problem's allocation table, and then
+// repairs it so that it is feasible. Allocations with no counterpart in the previous solution are
+// left empty.
+// Fills affectedRequirements and affectedSources with whether each requirement and source of the
+// current problem needs to be re-optimized, which is the case for:
+// - Requirements and sources that have been added or changed
+// - Requirements that lost any of their previous allocations, because their source or balance
+//   pool has been removed or changed, or because it is no longer a candidate
+// - Sources that were used by requirements that have been removed
+Vector patchSolution(const ProblemInstance& previous, const Vector& previousSolution,
+                     const InputDelta& delta, ProblemInstance& problem,
+                     std::vector<bool>& affectedRequirements, std::vector<bool>& affectedSources);
+
+// Builds a subproblem out of every independent component of the problem (see findComponents)
+// that contains an affected requirement or source. Its balance pools are given whatever the
+// problem's initial solution leaves of their budgets after the unaffected components have taken
+// their share, and its initial solution is the part of the problem's initial solution that
+// covers its allocations.
+// Returns false if there are no affected components.
+bool extractAffectedProblem(const ProblemInstance& problem,
+                            const std::vector<bool>& affectedRequirements,
+                            const std::vector<bool>& affectedSources, ReducedProblem& affected);
+
+#endif // _INCREMENTAL_H
@@ -0,0 +1,370 @@
+#include <assert.h>
+#include <math.h>
+#include <float.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "ledger.h"
+#include "fundmatch.h"
+
+using namespace std;
+
+static void treeAdd(MonthTree& tree, int node, int nodeFrom, int nodeTo,
+                    int fromIndex, int toIndex, float value)
+{
+    if((toIndex <= nodeFrom) || (nodeTo <= fromIndex))
+        return;
+
+    if((fromIndex <= nodeFrom) && (nodeTo <= toIndex))
+    {
+        tree.minValue[node] += value;
+        tree.pendingAdd[node] += value;
+        return;
+    }
+
+    int nodeMid = (nodeFrom + nodeTo)/2;
+    treeAdd(tree, 2*node, nodeFrom, nodeMid, fromIndex, toIndex, value);
+    treeAdd(tree, 2*node+1, nodeMid, nodeTo, fromIndex, toIndex, value);
+    tree.minValue[node] = min(tree.minValue[2*node], tree.minValue[2*node+1]) +
+                            tree.pendingAdd[node];
+}
+
+static float treeMin(const MonthTree& tree, int node, int nodeFrom, int nodeTo,
+                     int fromIndex, int toIndex)
+{
+    if((toIndex <= nodeFrom) || (nodeTo <= fromIndex))
+        return FLT_MAX;
+
+    if((fromIndex <= nodeFrom) && (nodeTo <= toIndex))
+        return tree.minValue[node];
+
+    int nodeMid = (nodeFrom + nodeTo)/2;
+    float leftMin = treeMin(tree, 2*node, nodeFrom, nodeMid, fromIndex, toIndex);
+    float rightMin = treeMin(tree, 2*node+1, nodeMid, nodeTo, fromIndex, toIndex);
+    return min(leftMin, rightMin) + tree.pendingAdd[node];
+}
+
+// NOTE: accumulatedAdd is the sum of the pending additions of all of node's ancestors
+static int treeFirstBelow(const MonthTree& tree, int node, int nodeFrom, int nodeTo,
+                          int fromIndex, float threshold, float accumulatedAdd)
+{
+    if((nodeTo <= fromIndex) || (tree.minValue[node] + accumulatedAdd >= threshold))
+        return -1;
+
+    if(nodeTo - nodeFrom == 1)
+        return nodeFrom;
+
+    int nodeMid = (nodeFrom + nodeTo)/2;
+    float childAdd = accumulatedAdd + tree.pendingAdd[node];
+    int result = treeFirstBelow(tree, 2*node, nodeFrom, nodeMid, fromIndex, threshold, childAdd);
+    if(result == -1)
+        result = treeFirstBelow(tree, 2*node+1, nodeMid, nodeTo, fromIndex, threshold, childAdd);
+    return result;
+}
+
+static void treeFill(MonthTree& tree, int node, int nodeFrom, int nodeTo, float value)
+{
+    tree.pendingAdd[node] = 0.0f;
+    if(nodeTo - nodeFrom == 1)
+    {
+        tree.minValue[node] = value;
+        return;
+    }
+
+    int nodeMid = (nodeFrom + nodeTo)/2;
+    treeFill(tree, 2*node, nodeFrom, nodeMid, value);
+    treeFill(tree, 2*node+1, nodeMid, nodeTo, value);
+    tree.minValue[node] = value;
+}
+
+void MonthTree::initialize(int firstMonth, int monthCount, float value)
+{
+    assert(monthCount > 0);
+    this->firstMonth = firstMonth;
+    this->monthCount = monthCount;
+    this->minValue.resize(4*monthCount);
+    this->pendingAdd.resize(4*monthCount);
+    treeFill(*this, 1, 0, monthCount, value);
+}
+
+void MonthTree::add(int fromMonth, int toMonth, float value)
+{
+    int fromIndex = max(fromMonth - firstMonth, 0);
+    int toIndex = min(toMonth - firstMonth, monthCount);
+    if(fromIndex >= toIndex)
+        return;
+
+    treeAdd(*this, 1, 0, monthCount, fromIndex, toIndex, value);
+}
+
+float MonthTree::rangeMin(int fromMonth, int toMonth) const
+{
+    if(fromMonth >= toMonth)
+        return FLT_MAX;
+    if((fromMonth < firstMonth) || (toMonth > firstMonth + monthCount))
+        return 0.0f;
+
+    return treeMin(*this, 1, 0, monthCount, fromMonth - firstMonth, toMonth - firstMonth);
+}
+
+int MonthTree::firstMonthBelow(int fromMonth, float threshold) const
+{
+    if(fromMonth < firstMonth)
+        return (threshold > 0.0f) ? fromMonth : firstMonth;
+    if(fromMonth >= firstMonth + monthCount)
+        return fromMonth;
+
+    int index = treeFirstBelow(*this, 1, 0, monthCount, fromMonth - firstMonth, threshold, 0.0f);
+    if(index == -1)
+        return firstMonth + monthCount;
+    return firstMonth + index;
+}
+
+void CapacityLedger::reset(const InputData& input)
+{
+    this->input = &input;
+    sourceRemaining.resize(input.sources.size());
+    for(int sourceID=0; sourceID<input.sources.size(); sourceID++)
+    {
+        const SourceInfo& source = input.sources[sourceID];
+        sourceRemaining[sourceID].initialize(source.startDate, max(source.tenor, 1),
+                                             (float)source.amount);
+    }
+
+    balancePoolRemaining.resize(input.balancePools.size());
+    for(int poolID=0; poolID<input.balancePools.size(); poolID++)
+    {
+        balancePoolRemaining[poolID] = (float)input.balancePools[poolID].amount;
+    }
+}
+
+void CapacityLedger::build(const Vector& position, ProblemInstance& problem)
+{
+    reset(problem.input);
+    for(int allocID=0; allocID<(int)problem.allocations.size(); allocID++)
+    {
+        addAllocation(problem.allocations[allocID], position);
+    }
+}
+
+void CapacityLedger::applyAllocation(const AllocationPointer& alloc, const Vector& position,
+                                     float sign)
+{
+    float tenor = alloc.getTenor(position);
+    float amount = alloc.getAmount(position);
+    // NOTE: Empty allocations don't use anything (and are ignored by the constraint checks)
+    if((tenor <= 0.0f) || (amount <= 0.0f))
+        return;
+
+    if(alloc.sourceIndex >= 0)
+    {
+        // NOTE: We round outwards to whole months here so that the ledger is conservative for
+        //       allocations that don't start/end on a month boundary
+        int startMonth = (int)floorf(alloc.getStartDate(position));
+        int endMonth = (int)ceilf(alloc.getEndDate(position));
+        sourceRemaining[alloc.sourceIndex].add(startMonth, endMonth, -sign*amount);
+    }
+    else
+    {
+        assert(alloc.balancePoolIndex >= 0);
+        balancePoolRemaining[alloc.balancePoolIndex] -= sign*amount;
+    }
+}
+
+void CapacityLedger::addAllocation(const AllocationPointer& alloc, const Vector& position)
+{
+    applyAllocation(alloc, position, 1.0f);
+}
+
+void CapacityLedger::removeAllocation(const AllocationPointer& alloc, const Vector& position)
+{
+    applyAllocation(alloc, position, -1.0f);
+}
+
+float CapacityLedger::availableAmount(const AllocationPointer& alloc,
+                                      int startMonth, int endMonth) const
+{
+    float result;
+    if(alloc.sourceIndex >= 0)
+        result = sourceRemaining[alloc.sourceIndex].rangeMin(startMonth, endMonth);
+    else
+        result = balancePoolRemaining[alloc.balancePoolIndex];
+
+    return max(result, 0.0f);
+}
+
+int CapacityLedger::maxFeasibleTenor(const AllocationPointer& alloc,
+                                     int startMonth, float amount) const
+{
+    int windowEnd = allocationWindowEnd(*input, alloc);
+    if(startMonth >= windowEnd)
+        return 0;
+    if(amount <= 0.0f)
+        return windowEnd - startMonth;
+
+    if(alloc.sourceIndex >= 0)
+    {
+        const MonthTree& tree = sourceRemaining[alloc.sourceIndex];
+        int endMonth = min(windowEnd, tree.firstMonthBelow(startMonth, amount));
+        return max(endMonth - startMonth, 0);
+    }
+    else
+    {
+        if(balancePoolRemaining[alloc.balancePoolIndex] >= amount)
+            return windowEnd - startMonth;
+        return 0;
+    }
+}
+
+bool CapacityLedger::fits(const AllocationPointer& alloc,
+                          float startDate, float tenor, float amount) const
+{
+    if((tenor <= 0.0f) || (amount <= 0.0f))
+        return true;
+
+    int startMonth = (int)floorf(startDate);
+    int endMonth = (int)ceilf(startDate + tenor);
+    return (availableAmount(alloc, startMonth, endMonth) >= amount);
+}
+
+int allocationWindowEnd(const InputData& input, const AllocationPointer& alloc)
+{
+    const RequirementInfo& req = input.requirements[alloc.requirementIndex];
+    int result = req.startDate + req.tenor;
+    if(alloc.sourceIndex >= 0)
+    {
+        const SourceInfo& source = input.sources[alloc.sourceIndex];
+        result = min(result, source.startDate + source.tenor);
+    }
+    return result;
+}
+
+void initializeFeasiblePosition(Vector& position, CapacityLedger& ledger,
+                                ProblemInstance& problem, RandomStream& rng)
+{
+    InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    vector<int> allocOrder(allocCount);
+    for(int allocID=0; allocID<allocCount; allocID++)
+        allocOrder[allocID] = allocID;
+    shuffle(allocOrder.begin(), allocOrder.end(), rng);
+
+    ledger.reset(input);
+    for(int orderIndex=0; orderIndex<allocCount; orderIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocOrder[orderIndex]];
+        assert(((alloc.sourceIndex == -1) && (alloc.balancePoolIndex >= 0)) ||
+                ((alloc.sourceIndex >= 0) && (alloc.balancePoolIndex == -1)));
+
+        float minStartDate = alloc.getMinStartDate(input);
+        float maxStartDate = alloc.getMaxStartDate(input);
+        float dateRange = maxStartDate - minStartDate;
+        assert(dateRange >= 0.0f);
+        float startDate = round(minStartDate + (rng.uniformf() * dateRange));
+
+        float maxTenor = (float)(allocationWindowEnd(input, alloc) - (int)startDate);
+        float tenor = round(rng.uniformf() * maxTenor);
+
+        float available = ledger.availableAmount(alloc, (int)startDate, (int)(startDate + tenor));
+        float maxAmount = min(alloc.getMaxAmount(input, position), available);
+        float amount = floorf(rng.uniformf() * maxAmount);
+
+        alloc.setStartDate(position, startDate);
+        alloc.setTenor(position, tenor);
+        alloc.setAmount(position, amount);
+        ledger.addAllocation(alloc, position);
+    }
+}
+
+static void clampAllocationToBounds(const InputData& input, AllocationPointer& alloc,
+                                    Vector& position)
+{
+    float startDate = alloc.getStartDate(position);
+    float tenor = alloc.getTenor(position);
+    float amount = alloc.getAmount(position);
+    if((tenor <= 0.0f) || (amount <= 0.0f))
+        return;
+
+    startDate = max(startDate, alloc.getMinStartDate(input));
+    startDate = min(startDate, alloc.getMaxStartDate(input));
+    tenor = min(tenor, (float)allocationWindowEnd(input, alloc) - startDate);
+    amount = min(amount, alloc.getMaxAmount(input, position));
+
+    alloc.setStartDate(position, startDate);
+    alloc.setTenor(position, tenor);
+    alloc.setAmount(position, amount);
+}
+
+static void repairAllocationOrder(const InputData& input, Vector& position,
+                                  CapacityLedger& ledger, vector<AllocationPointer*>& allocOrder)
+{
+    ledger.reset(input);
+    for(int orderIndex=0; orderIndex<allocOrder.size(); orderIndex++)
+    {
+        AllocationPointer& alloc = *allocOrder[orderIndex];
+        float startDate = alloc.getStartDate(position);
+        float tenor = alloc.getTenor(position);
+        float amount = alloc.getAmount(position);
+        if(ledger.fits(alloc, startDate, tenor, amount))
+        {
+            ledger.addAllocation(alloc, position);
+            continue;
+        }
+
+        // NOTE: We compare the two options by how much of the allocation (amount*tenor) they keep
+        int startMonth = (int)floorf(startDate);
+        int endMonth = (int)ceilf(startDate + tenor);
+        float reducedAmount = floorf(ledger.availableAmount(alloc, startMonth, endMonth));
+        float reducedTenor = (float)ledger.maxFeasibleTenor(alloc, startMonth, amount);
+        reducedTenor = min(reducedTenor, tenor);
+        if((startDate != (float)startMonth) && (reducedTenor > 0.0f))
+            reducedTenor -= 1.0f; // The ledger rounds the start down, so we lose the last month
+
+        if(reducedAmount*tenor >= amount*reducedTenor)
+            alloc.setAmount(position, reducedAmount);
+        else
+            alloc.setTenor(position, reducedTenor);
+        ledger.addAllocation(alloc, position);
+    }
+}
+
+void repairPosition(Vector& position, CapacityLedger& ledger, ProblemInstance& problem)
+{
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    vector<AllocationPointer*> allocOrder(allocCount);
+    for(int allocID=0; allocID<allocCount; allocID++)
+    {
+        clampAllocationToBounds(problem.input, allocations[allocID], position);
+        allocOrder[allocID] = &allocations[allocID];
+    }
+
+    auto allocStartDateComparison = [&position](AllocationPointer* a, AllocationPointer* b)
+    {
+        float aStart = a->getStartDate(position);
+        float bStart = b->getStartDate(position);
+        if(aStart != bStart)
+            return aStart < bStart;
+        return a->allocStartDimension < b->allocStartDimension;
+    };
+    sort(allocOrder.begin(), allocOrder.end(), allocStartDateComparison);
+    repairAllocationOrder(problem.input, position, ledger, allocOrder);
+
+    // NOTE: Fractional amounts can leave a tiny over-use due to floating-point rounding, because
+    //       the ledger and measureConstraintViolation sum the amounts in a different order. In that
+    //       case we round all of the amounts down to whole numbers (which sum exactly) and repair
+    //       again.
+    if(!isFeasible(position, problem))
+    {
+        for(int allocID=0; allocID<allocCount; allocID++)
+        {
+            float amount = allocations[allocID].getAmount(position);
+            allocations[allocID].setAmount(position, floorf(amount));
+        }
+        repairAllocationOrder(problem.input, position, ledger, allocOrder);
+    }
+}
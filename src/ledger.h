@@ -0,0 +1,90 @@
+#ifndef _LEDGER_H
+#define _LEDGER_H
+
+#include <vector>
+
+#include "fundmatch.h"
+#include "random.h"
+
+// A segment tree over a contiguous range of months that supports adding a value to a range of
+// months and querying the minimum value over a range of months, both in O(log(monthCount))
+struct MonthTree
+{
+    int firstMonth;
+    int monthCount;
+    std::vector<float> minValue;
+    std::vector<float> pendingAdd;
+
+    void initialize(int firstMonth, int monthCount, float value);
+
+    // NOTE: All month ranges are half-open, IE [fromMonth, toMonth)
+    void add(int fromMonth, int toMonth, float value);
+
+    // Returns the smallest value in the given range of months. Months that lie outside of the tree
+    // are treated as having a value of 0 (IE there is nothing available outside of the tree).
+    float rangeMin(int fromMonth, int toMonth) const;
+
+    // Returns the first month >= fromMonth whose value is less than the given threshold, or the
+    // month just after the end of the tree if there is no such month
+    int firstMonthBelow(int fromMonth, float threshold) const;
+};
+
+// Tracks how much of each source and balance pool is still available, given the allocations in a
+// particular position vector.
+// NOTE: Sources are available only during their own date range, and their amount is a per-month
+//       capacity. Balance pools have no date range and allocations never return their amount to
+//       the pool, so they are tracked as a single remaining budget (matching the way that
+//       measureConstraintViolation and the heuristic treat them).
+struct CapacityLedger
+{
+    const InputData* input; // The input that the sources and balance pools belong to
+    std::vector<MonthTree> sourceRemaining;
+    std::vector<float> balancePoolRemaining;
+
+    // Resets the ledger so that every source and balance pool of the given input is entirely unused
+    void reset(const InputData& input);
+
+    // Resets the ledger and then adds every (non-empty) allocation in the given position vector
+    void build(const Vector& position, ProblemInstance& problem);
+
+    void addAllocation(const AllocationPointer& alloc, const Vector& position);
+    void removeAllocation(const AllocationPointer& alloc, const Vector& position);
+
+    // Returns the largest amount that can be allocated to alloc over [startMonth, endMonth),
+    // given everything currently in the ledger
+    float availableAmount(const AllocationPointer& alloc, int startMonth, int endMonth) const;
+
+    // Returns the largest tenor that alloc can have if it starts at startMonth with the given
+    // amount, without leaving the window in which the allocation is sensible, or over-using its
+    // source
+    int maxFeasibleTenor(const AllocationPointer& alloc, int startMonth, float amount) const;
+
+    // Returns true iff the given values for alloc can be added to the ledger without over-using
+    // its source or balance pool
+    bool fits(const AllocationPointer& alloc, float startDate, float tenor, float amount) const;
+
+private:
+    void applyAllocation(const AllocationPointer& alloc, const Vector& position, float sign);
+};
+
+// Returns the (exclusive) month after which allocations for alloc are no longer sensible, IE the
+// end of the overlap between its requirement and its source
+int allocationWindowEnd(const InputData& input, const AllocationPointer& alloc);
+
+// Gives random initial values to every allocation in the given position vector, such that the
+// resulting position is always feasible. Allocations are visited in a random order and each one
+// is only given an amount that is still available after all of the allocations before it.
+// NOTE: The ledger is used as scratch space, and afterwards contains exactly the new position
+void initializeFeasiblePosition(Vector& position, CapacityLedger& ledger,
+                                ProblemInstance& problem, RandomStream& rng);
+
+// Deterministically shrinks allocations in the given position until it is feasible.
+// Every allocation is first clamped into its own window and amount bound. The allocations are then
+// added to the ledger in order of start date, and any allocation that would over-use its source
+// or balance pool is cut back to either the amount that is still available over its whole tenor,
+// or the longest tenor over which its full amount is still available, whichever keeps more of it.
+// Allocations that don't contribute to an over-use are left unchanged.
+// NOTE: The ledger is used as scratch space, and afterwards contains exactly the repaired position
+void repairPosition(Vector& position, CapacityLedger& ledger, ProblemInstance& problem);
+
+#endif // _LEDGER_H
@@ -3,9 +3,11 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+bool FileLogger::isDisabled = false;
+
 FileLogger::FileLogger(const char* filename)
+    : filename(filename), outFile(nullptr)
 {
-    outFile = fopen(filename, "w");
 }
 
 FileLogger::~FileLogger()
@@ -19,6 +21,10 @@ FileLogger::~FileLogger()
 
 void FileLogger::log(const char* message, ...)
 {
+    if(isDisabled)
+        return;
+    if(!outFile)
+        outFile = fopen(filename, "w");
     if(outFile)
     {
         va_list args;
@@ -28,3 +34,8 @@ void FileLogger::log(const char* message, ...)
         fflush(outFile);
     }
 }
+
+void FileLogger::disableAll()
+{
+    isDisabled = true;
+}
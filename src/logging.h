@@ -3,6 +3,9 @@
 
 #include <stdio.h>
 
+// Logs to the given file, which is only created once something is logged to it
+// NOTE: Loggers aren't shared safely between concurrent jobs, so a process that runs several jobs
+//       at once turns them all off first (see disableAll)
 class FileLogger
 {
 public:
@@ -11,8 +14,15 @@ public:
 
     void log(const char* message, ...);
 
+    // Makes every logger ignore what it is given from now on
+    // NOTE: This must be called before any threads that might log start
+    static void disableAll();
+
 private:
+    const char* filename;
     FILE* outFile;
+
+    static bool isDisabled;
 };
 
 #endif // _LOGGING_H
@@ -1,157 +1,258 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include <time.h>
 #include <vector>
+#include <random>
 #include <algorithm>
 
 #include "fundmatch.h"
 #include "dataio.h"
+#include "bounds.h"
+#include "pipeline.h"
+#include "daemon.h"
+#include "parallel.h"
+#include "timing.h"
+#include "logging.h"
 
 using namespace std;
 
 const int MAX_FILEPATH_LENGTH = 512;
+const int MAX_RESULT_LENGTH = 512;
 
-int main(int argc, char** argv)
+// A dataset that has been loaded and prepared (but not solved), which every job on it copies
+struct Dataset
 {
-    clock_t loadStartTime = clock();
-    clock_t clockFrequency = CLOCKS_PER_SEC;
+    const char* name;
+    ProblemInstance problem;
+};
 
-    const char* dataName = (argc > 1) ? argv[1] : "DS1";
+// A solution from an earlier run, which every job re-optimizes incrementally (if there is one)
+struct PreviousRun
+{
+    ProblemInstance problem;
+    Vector solution;
+};
 
-    char sourceFilename[MAX_FILEPATH_LENGTH];
-    snprintf(sourceFilename, MAX_FILEPATH_LENGTH, "data/%s_sources.csv", dataName);
-    if(!loadSourceData(sourceFilename, g_input))
-    {
-        printf("Error: Unable to load source data from %s\n", sourceFilename);
-        return -1;
-    }
-    printf("Loaded %zd sources\n", g_input.sources.size());
+// Loads the named dataset into the given problem (whose options must already be set) and
+// prepares it for solving.
+// Returns true iff all of the dataset's files were loaded successfully.
+static bool prepareDataset(const char* dataName, ProblemInstance& problem)
+{
+    double loadStartTime = steadyClockSeconds();
+    if(!loadDataset(dataName, problem.input))
+        return false;
+    printf("Input data loaded in %.2fs\n", steadyClockSeconds() - loadStartTime);
 
-    char balancePoolFilename[MAX_FILEPATH_LENGTH];
-    snprintf(balancePoolFilename, MAX_FILEPATH_LENGTH, "data/%s_balancepools.csv", dataName);
-    if(!loadBalancePoolData(balancePoolFilename, g_input))
-    {
-        printf("Error: Unable to load balance pool data from %s\n", balancePoolFilename);
-        return -1;
-    }
-    printf("Loaded %zd balance pools\n", g_input.balancePools.size());
+    prepareProblem(problem);
 
-    char requirementFilename[MAX_FILEPATH_LENGTH];
-    snprintf(requirementFilename, MAX_FILEPATH_LENGTH, "data/%s_requirements.csv", dataName);
-    if(!loadRequirementData(requirementFilename, g_input))
+    ProblemInstance manualProblem;
+    manualProblem.input = problem.input;
+    char allocationFilename[MAX_FILEPATH_LENGTH];
+    snprintf(allocationFilename, MAX_FILEPATH_LENGTH, "data/%s_allocations.csv", dataName);
+    Vector manualSolution = loadAllocationData(allocationFilename, manualProblem.allocations);
+    if(manualSolution.dimensions > 0)
     {
-        printf("Error: Unable to load requirement data from %s\n", requirementFilename);
-        return -1;
+        //assert(isFeasible(manualSolution, manualProblem));
+        float manualFitness = computeFitness(manualSolution, manualProblem);
+        printf("Manual solution has %zd allocations and costs %.2f\n",
+                manualProblem.allocations.size(), manualFitness);
     }
-    printf("Loaded %zd requirements\n", g_input.requirements.size());
+    return true;
+}
 
-    // Count the number of valid allocations, so we know how many to construct below
-    // NOTE: First allocations are from balance pools in our valid allocation list
-    int validAllocationCount = (int)(g_input.balancePools.size() * g_input.requirements.size());
-    for(int reqID=0; reqID<g_input.requirements.size(); reqID++)
-    {
-        for(int sourceID=0; sourceID<g_input.sources.size(); sourceID++)
-        {
-            SourceInfo& src = g_input.sources[sourceID];
-            RequirementInfo& req = g_input.requirements[reqID];
-            if((src.taxClass == req.taxClass) && (maxAllocationTenor(src, req) >= 1))
-            {
-                validAllocationCount++;
-            }
-        }
-    }
+// Solves a copy of the given dataset's problem with the given seed and time limit (0 for none),
+// incrementally from the previous run's solution if there is one, writes the solution to the
+// given file and then prints the result, prefixed by the given label
+static void solveDataset(const Dataset& dataset, const PreviousRun& previous, uint64_t seed,
+                         float timeLimit, const char* outputFilename, const char* label)
+{
+    // NOTE: Jobs run concurrently, so we measure wall-clock time rather than the process' CPU time
+    double computeStartTime = steadyClockSeconds();
+    ProblemInstance problem = dataset.problem;
+    problem.options.seed = seed;
+    if(timeLimit > 0.0f)
+        problem.options.deadline = computeStartTime + timeLimit;
 
-    // Create allocations and set the source/requirement/balancePool that they correspond to
-    AllocationPointer* allocations = new AllocationPointer[validAllocationCount];
-    memset(allocations, 0, validAllocationCount*sizeof(AllocationPointer));
-    for(int i=0; i<validAllocationCount; i++)
-    {
-        allocations[i].allocStartDimension = i*DIMENSIONS_PER_ALLOCATION;
-    }
+    Vector solution;
+    if(previous.solution.dimensions > 0)
+        solution = solveProblemIncrementally(problem, previous.problem, previous.solution);
+    else
+        solution = solveProblem(problem);
+    float solutionFitness = -1.0f;
+    if(isFeasible(solution, problem))
+        solutionFitness = computeFitness(solution, problem);
+
+    float computeSeconds = (float)(steadyClockSeconds() - computeStartTime);
+    int generatedAllocs = writeOutputData(problem, solution, outputFilename);
 
-    int currentAllocIndex = 0;
-    for(int reqID=0; reqID<g_input.requirements.size(); reqID++)
+    // NOTE: The gap comes after the fitness and allocation count so that scripts that only look for
+    //       those still work. The line is printed all at once so that the results of concurrent
+    //       jobs never get mixed together.
+    char result[MAX_RESULT_LENGTH];
+    int resultLength = snprintf(result, MAX_RESULT_LENGTH,
+                                "%sOptimization completed in %.2fs - final fitness was %.2f "
+                                "from %d allocations",
+                                label, computeSeconds, solutionFitness, generatedAllocs);
+    if((solutionFitness >= 0.0f) && hasLowerBound(problem) && (resultLength < MAX_RESULT_LENGTH))
+        snprintf(result + resultLength, MAX_RESULT_LENGTH - resultLength, " with a gap of %.2f%%",
+                 computeOptimalityGap(problem, solutionFitness));
+    printf("%s\n", result);
+}
+
+int main(int argc, char** argv)
+{
+    RunOptions options = ProblemInstance().options;
+    vector<const char*> dataNames;
+    int repeatCount = 1;
+    int jobThreadCount = 1;
+    float timeLimit = 0.0f;
+    const char* daemonSocketPath = nullptr;
+    const char* previousFilename = nullptr;
+    const char* warmStartFilename = nullptr;
+    bool seedSpecified = false;
+    for(int argIndex=1; argIndex<argc; argIndex++)
     {
-        for(int balanceID=0; balanceID<g_input.balancePools.size(); balanceID++)
+        const char* arg = argv[argIndex];
+        bool hasValue = (argIndex+1 < argc);
+        if((strcmp(arg, "--seed") == 0) && hasValue)
         {
-            allocations[currentAllocIndex].sourceIndex = -1;
-            allocations[currentAllocIndex].requirementIndex = reqID;
-            allocations[currentAllocIndex].balancePoolIndex = balanceID;
-            currentAllocIndex++;
+            options.seed = strtoull(argv[++argIndex], nullptr, 10);
+            seedSpecified = true;
+        }
+        else if((strcmp(arg, "--gap-target") == 0) && hasValue)
+        {
+            options.gapTarget = (float)atof(argv[++argIndex]);
+        }
+        else if((strcmp(arg, "--time-limit") == 0) && hasValue)
+        {
+            timeLimit = (float)atof(argv[++argIndex]);
+        }
+        else if(strcmp(arg, "--no-presolve") == 0)
+        {
+            options.skipPresolve = true;
+        }
+        else if(strcmp(arg, "--no-decompose") == 0)
+        {
+            options.skipDecomposition = true;
+        }
+        else if(strcmp(arg, "--no-bound") == 0)
+        {
+            options.skipBound = true;
+        }
+        else if((strcmp(arg, "--top-k") == 0) && hasValue)
+        {
+            options.topK = atoi(argv[++argIndex]);
+        }
+        else if((strcmp(arg, "--horizon") == 0) && hasValue)
+        {
+            options.horizonMonths = atoi(argv[++argIndex]);
+        }
+        else if((strcmp(arg, "--repeat") == 0) && hasValue)
+        {
+            repeatCount = max(atoi(argv[++argIndex]), 1);
+        }
+        else if((strcmp(arg, "--jobs") == 0) && hasValue)
+        {
+            jobThreadCount = max(atoi(argv[++argIndex]), 1);
+        }
+        else if((strcmp(arg, "--incremental") == 0) && hasValue)
+        {
+            previousFilename = argv[++argIndex];
+        }
+        else if((strcmp(arg, "--warm-start") == 0) && hasValue)
+        {
+            warmStartFilename = argv[++argIndex];
+        }
+        else if((strcmp(arg, "--daemon") == 0) && hasValue)
+        {
+            daemonSocketPath = argv[++argIndex];
+        }
+        else if(arg[0] == '-')
+        {
+            printf("Error: Unrecognized option %s\n", arg);
+            return -1;
+        }
+        else
+        {
+            dataNames.push_back(arg);
         }
     }
-    for(int reqID=0; reqID<g_input.requirements.size(); reqID++)
+    if(dataNames.empty())
+        dataNames.push_back("DS1");
+    if(options.skipBound && (options.gapTarget > 0.0f))
     {
-        for(int sourceID=0; sourceID<g_input.sources.size(); sourceID++)
-        {
-            RequirementInfo& req = g_input.requirements[reqID];
-            SourceInfo& src = g_input.sources[sourceID];
-            if((src.taxClass == req.taxClass) && (maxAllocationTenor(src, req) >= 1))
-            {
-                allocations[currentAllocIndex].sourceIndex = sourceID;
-                allocations[currentAllocIndex].requirementIndex = reqID;
-                allocations[currentAllocIndex].balancePoolIndex = -1;
-                currentAllocIndex++;
-            }
-        }
+        printf("Error: A gap target needs the lower bound, so it can't be used with --no-bound\n");
+        return -1;
     }
 
-    // Create the sorted requirements lists and sort them
-    for(int i=0; i<g_input.requirements.size(); i++)
+    if(!seedSpecified)
     {
-        g_input.requirementsByStart.push_back(i);
-        g_input.requirementsByEnd.push_back(i);
+        random_device randDevice;
+        options.seed = ((uint64_t)randDevice() << 32) | (uint64_t)randDevice();
     }
+    printf("Using random seed %llu\n", (unsigned long long)options.seed);
 
-    auto reqStartDateComparison = [](int reqIndexA, int reqIndexB)
-    {
-        int aStart = g_input.requirements[reqIndexA].startDate;
-        int bStart = g_input.requirements[reqIndexB].startDate;
-        return aStart < bStart;
-    };
-    auto reqEndDateComparison = [](int reqIndexA, int reqIndexB)
+    if(daemonSocketPath != nullptr)
+        return runDaemon(daemonSocketPath, options, timeLimit);
+
+    PreviousRun previous;
+    if(previousFilename != nullptr)
     {
-        int aEnd = g_input.requirements[reqIndexA].startDate +
-                    g_input.requirements[reqIndexA].tenor;
-        int bEnd = g_input.requirements[reqIndexB].startDate +
-                    g_input.requirements[reqIndexB].tenor;
-        return aEnd < bEnd;
-    };
-    sort(g_input.requirementsByStart.begin(), g_input.requirementsByStart.end(),
-            reqStartDateComparison);
-    sort(g_input.requirementsByEnd.begin(), g_input.requirementsByEnd.end(),
-            reqEndDateComparison);
-
-    clock_t loadEndTime = clock();
-    float loadSeconds = (float)(loadEndTime-loadStartTime)/(float)clockFrequency;
-    printf("Input data loaded in %.2fs\n", loadSeconds);
-
-    printf("Computing values for %d allocations...\n", validAllocationCount);
-    Vector solution = computeAllocations(validAllocationCount, allocations);
-    float solutionFitness = -1.0f;
-    if(isFeasible(solution, validAllocationCount, allocations))
-        solutionFitness = computeFitness(solution, validAllocationCount, allocations);
+        previous.solution = loadOutputData(previousFilename, previous.problem.input,
+                                           previous.problem.allocations);
+        if(previous.solution.dimensions == 0)
+        {
+            printf("Error: Unable to load a previous solution from %s\n", previousFilename);
+            return -1;
+        }
+        printf("Loaded a previous solution with %zd allocations\n",
+               previous.problem.allocations.size());
+    }
 
-    vector<AllocationPointer> manAllocVector;
-    char allocationFilename[MAX_FILEPATH_LENGTH];
-    snprintf(allocationFilename, MAX_FILEPATH_LENGTH, "data/%s_allocations.csv", dataName);
-    Vector manualSolution = loadAllocationData(allocationFilename, manAllocVector);
-    if(manualSolution.dimensions > 0)
+    // NOTE: Each dataset is only loaded (and its lower bound computed) once, no matter how many
+    //       times it is solved
+    int datasetCount = (int)dataNames.size();
+    vector<Dataset> datasets(datasetCount);
+    for(int datasetIndex=0; datasetIndex<datasetCount; datasetIndex++)
     {
-        int manAllocCount = (int)manAllocVector.size();
-        AllocationPointer* manAllocs = &manAllocVector[0];
-        //assert(isFeasible(manualSolution, manAllocCount, manAllocs));
-        float manualFitness = computeFitness(manualSolution, manAllocCount, manAllocs);
-        printf("Manual solution has %d allocations and costs %.2f\n",
-                manAllocCount, manualFitness);
+        Dataset& dataset = datasets[datasetIndex];
+        dataset.name = dataNames[datasetIndex];
+        dataset.problem.options = options;
+        if(!prepareDataset(dataset.name, dataset.problem))
+            return -1;
+        if((warmStartFilename != nullptr) && !loadWarmStart(warmStartFilename, dataset.problem))
+            return -1;
     }
 
-    clock_t computeEndTime = clock();
-    float computeSeconds = (float)(computeEndTime - loadEndTime)/(float)clockFrequency;
+    // Solve every dataset repeatCount times, with the seed of each repeat offset by its index
+    // NOTE: A single job keeps the original output file and result line. With several jobs, each
+    //       one gets its own output file and its result line is labelled with its dataset and
+    //       repeat. Each job's solver still spreads its own work across every thread, so running
+    //       several jobs at once mostly helps with the solvers that are largely serial. The
+    //       solvers' fitness plots would mix every job's progress together, so they are off.
+    int jobCount = datasetCount*repeatCount;
+    if(jobCount > 1)
+        FileLogger::disableAll();
+    parallelFor(jobCount, jobThreadCount, [&](int jobIndex)
+    {
+        const Dataset& dataset = datasets[jobIndex / repeatCount];
+        int repeatIndex = jobIndex % repeatCount;
 
-    int generatedAllocs = writeOutputData(g_input, validAllocationCount, allocations,
-                                          solution, "output.json");
-    printf("Optimization completed in %.2fs - final fitness was %.2f from %d allocations\n",
-            computeSeconds, solutionFitness, generatedAllocs);
+        char outputFilename[MAX_FILEPATH_LENGTH];
+        char label[MAX_FILEPATH_LENGTH];
+        if(jobCount == 1)
+        {
+            snprintf(outputFilename, MAX_FILEPATH_LENGTH, "output.json");
+            label[0] = '\0';
+        }
+        else
+        {
+            snprintf(outputFilename, MAX_FILEPATH_LENGTH, "output_%s_%d.json",
+                     dataset.name, repeatIndex+1);
+            snprintf(label, MAX_FILEPATH_LENGTH, "%s #%d: ", dataset.name, repeatIndex+1);
+        }
+        solveDataset(dataset, previous, options.seed + (uint64_t)repeatIndex, timeLimit,
+                     outputFilename, label);
+    });
 }
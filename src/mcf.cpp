@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "mcf.h"
+#include "flow.h"
+#include "fundmatch.h"
+#include "ledger.h"
+#include "logging.h"
+
+using namespace std;
+
+const char* const SOLVER_NAME = "mcf";
+const bool SOLVER_IS_PARALLEL = false;
+const bool SOLVER_IS_BASELINE = false;
+
+static FileLogger plotLog = FileLogger("mcf_fitness.dat");
+
+// Finds the rectangle (IE a constant amount over a range of months) with the largest area under
+// the given flows, which must all be for the same allocation and be sorted by month
+// NOTE: This is the usual stack-based search for the largest rectangle in a histogram, except
+//       that each bar of the histogram can cover several months
+static void largestRectangleUnderFlows(const vector<RelaxedFlow>& flows,
+                                       const vector<int>& flowIndices,
+                                       int& startDate, int& tenor, int& amount)
+{
+    struct Bar
+    {
+        int fromMonth;
+        int height;
+    };
+    vector<Bar> stack;
+    int64_t bestArea = 0;
+    startDate = 0;
+    tenor = 0;
+    amount = 0;
+
+    auto popBarsNotBelow = [&](int month, int height) -> int
+    {
+        int barStart = month;
+        while(!stack.empty() && (stack.back().height >= height))
+        {
+            Bar bar = stack.back();
+            stack.pop_back();
+            int64_t area = (int64_t)bar.height * (int64_t)(month - bar.fromMonth);
+            if(area > bestArea)
+            {
+                bestArea = area;
+                startDate = bar.fromMonth;
+                tenor = month - bar.fromMonth;
+                amount = bar.height;
+            }
+            barStart = bar.fromMonth;
+        }
+        return barStart;
+    };
+
+    int previousEnd = INT32_MIN;
+    for(int i=0; i<(int)flowIndices.size(); i++)
+    {
+        const RelaxedFlow& flow = flows[flowIndices[i]];
+        // NOTE: Any months in between flows have nothing flowing, so nothing can span them
+        if(flow.fromMonth != previousEnd)
+            popBarsNotBelow(previousEnd, 0);
+
+        Bar bar;
+        bar.fromMonth = popBarsNotBelow(flow.fromMonth, flow.amount);
+        bar.height = flow.amount;
+        stack.push_back(bar);
+        previousEnd = flow.toMonth;
+    }
+    popBarsNotBelow(previousEnd, 0);
+}
+
+Vector computeAllocations(ProblemInstance& problem)
+{
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    vector<RelaxedFlow> flows;
+    double relaxedCost = solveMonthlyRelaxation(problem.input, INCLUDE_BALANCE_POOLS, &flows);
+    printf("Monthly relaxation has cost %.2f from %d flows\n", relaxedCost, (int)flows.size());
+
+    // Find the allocation that each flow belongs to
+    vector<vector<int>> requirementAllocations(problem.input.requirements.size());
+    for(int allocIndex=0; allocIndex<allocationCount; allocIndex++)
+    {
+        requirementAllocations[allocations[allocIndex].requirementIndex].push_back(allocIndex);
+    }
+    vector<vector<int>> allocationFlows(allocationCount);
+    for(int flowIndex=0; flowIndex<(int)flows.size(); flowIndex++)
+    {
+        RelaxedFlow& flow = flows[flowIndex];
+        const vector<int>& candidates = requirementAllocations[flow.requirementIndex];
+        for(int i=0; i<(int)candidates.size(); i++)
+        {
+            AllocationPointer& alloc = allocations[candidates[i]];
+            if((alloc.sourceIndex == flow.sourceIndex) &&
+               (alloc.balancePoolIndex == flow.balancePoolIndex))
+            {
+                allocationFlows[candidates[i]].push_back(flowIndex);
+                break;
+            }
+        }
+    }
+
+    // NOTE: Each allocation can only have a single amount over a single range of months, so we
+    //       keep the largest such block of its flow. Whatever this leaves uncovered gets picked up
+    //       by polishing afterwards.
+    int dimensionCount = allocationCount * DIMENSIONS_PER_ALLOCATION;
+    Vector solution(dimensionCount);
+    for(int allocIndex=0; allocIndex<allocationCount; allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        vector<int>& flowIndices = allocationFlows[allocIndex];
+        sort(flowIndices.begin(), flowIndices.end(), [&flows](int a, int b)
+        {
+            return flows[a].fromMonth < flows[b].fromMonth;
+        });
+
+        int startDate;
+        int tenor;
+        int amount;
+        largestRectangleUnderFlows(flows, flowIndices, startDate, tenor, amount);
+        if((tenor <= 0) || (amount <= 0))
+        {
+            startDate = (int)alloc.getMinStartDate(problem.input);
+            tenor = 0;
+            amount = 0;
+        }
+        alloc.setStartDate(solution, (float)startDate);
+        alloc.setTenor(solution, (float)tenor);
+        alloc.setAmount(solution, (float)amount);
+    }
+
+    // NOTE: Sources can never be over-used here, but the balance pools are a budget across all
+    //       months rather than a capacity in each month, so they can be
+    CapacityLedger ledger;
+    repairPosition(solution, ledger, problem);
+
+    assert(isFeasible(solution, problem));
+    float fitness = computeFitness(solution, problem);
+    plotLog.log("%.2f", fitness);
+
+    return solution;
+}
@@ -0,0 +1,9 @@
+#ifndef _MCF_H
+#define _MCF_H
+
+// If true, balance pools are included in the flow network as a capacity that is available in
+// every month. Otherwise only sources are used, and the balance pools are left for polishing to
+// fill in.
+const bool INCLUDE_BALANCE_POOLS = true;
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Returns the number of threads that parallelFor will spread its work across
+inline int parallelThreadCount()
+{
+    int threadCount = (int)std::thread::hardware_concurrency();
+    if(threadCount < 1)
+        threadCount = 1;
+    return threadCount;
+}
+
+// Calls body(index) for every index in [0, count), spread across (at most) threadCount threads.
+// NOTE: Indices are handed out one at a time, so body does not need to take a similar amount of
+//       time for each index, but it does need to be safe to call concurrently.
+template<typename Body>
+void parallelFor(int count, int threadCount, Body body)
+{
+    if(threadCount < 1)
+        threadCount = 1;
+    if(threadCount > count)
+        threadCount = count;
+
+    std::atomic<int> nextIndex(0);
+    auto worker = [&]()
+    {
+        int index;
+        while((index = nextIndex++) < count)
+            body(index);
+    };
+
+    std::vector<std::thread> threads;
+    for(int i=1; i<threadCount; i++)
+        threads.push_back(std::thread(worker));
+    worker();
+    for(int i=0; i<(int)threads.size(); i++)
+        threads[i].join();
+}
+
+// Calls body(index) for every index in [0, count), spread across all available hardware threads
+template<typename Body>
+void parallelFor(int count, Body body)
+{
+    parallelFor(count, parallelThreadCount(), body);
+}
+
+#endif // _PARALLEL_H
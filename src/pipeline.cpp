@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "pipeline.h"
+#include "fundmatch.h"
+#include "dataio.h"
+#include "polish.h"
+#include "bounds.h"
+#include "candidates.h"
+#include "presolve.h"
+#include "decompose.h"
+#include "horizon.h"
+#include "incremental.h"
+#include "ledger.h"
+#include "timing.h"
+
+using namespace std;
+
+const int MAX_FILEPATH_LENGTH = 512;
+
+static Vector solveComponents(ProblemInstance& problem)
+{
+    if(problem.options.skipDecomposition)
+        return computeAllocations(problem);
+    return solveDecomposed(problem);
+}
+
+static Vector solveAllocations(ProblemInstance& problem)
+{
+    if(problem.options.horizonMonths > 0)
+        return solveRollingHorizon(problem, solveComponents);
+    return solveComponents(problem);
+}
+
+static int countChanged(const vector<bool>& changed)
+{
+    return (int)count(changed.begin(), changed.end(), true);
+}
+
+static int countRemoved(const vector<int>& previousMap)
+{
+    return (int)count(previousMap.begin(), previousMap.end(), -1);
+}
+
+// Returns whichever of the given solution and the problem's (repaired) initial solution is better
+// once they have both been polished
+// NOTE: Some solvers ignore the initial solution, so we keep it if they can't beat it. Both are
+//       polished first, since the solvers' raw solutions are often only better after polishing.
+static Vector keepBetterSolution(ProblemInstance& problem, Vector solution)
+{
+    CapacityLedger ledger;
+    Vector initialSolution = problem.initialSolution;
+    repairPosition(initialSolution, ledger, problem);
+    initialSolution.processPositionUpdate(problem);
+    polishSolution(initialSolution, problem);
+    solution.processPositionUpdate(problem);
+    polishSolution(solution, problem);
+    if(isPositionBetter(initialSolution, solution))
+        return initialSolution;
+    return solution;
+}
+
+// Polishes the given solution of the problem, and then gives under-served requirements more
+// candidates when the options limit them
+static Vector polishProblemSolution(ProblemInstance& problem, Vector solution)
+{
+    double polishStartTime = steadyClockSeconds();
+    solution.processPositionUpdate(problem);
+    if(SOLVER_IS_BASELINE)
+        return solution;
+    Vector unpolishedSolution = solution;
+    if(polishSolution(solution, problem))
+    {
+        float polishSeconds = (float)(steadyClockSeconds() - polishStartTime);
+        if(unpolishedSolution.constraintViolation == 0.0f)
+            printf("Polishing improved fitness from %.2f to %.2f in %.3fs\n",
+                    unpolishedSolution.fitness, solution.fitness, polishSeconds);
+        else
+            printf("Polishing made the solution feasible with fitness %.2f in %.3fs\n",
+                    solution.fitness, polishSeconds);
+    }
+
+    // NOTE: When we only started with the best few sources for each requirement, the solution can
+    //       leave requirements to the RCF that other sources could have covered. We give those
+    //       requirements more sources and let polishing make use of them.
+    if(problem.options.topK > 0)
+    {
+        vector<int> sourceLimits(problem.input.requirements.size(), problem.options.topK);
+        for(int expansion=0; expansion<MAX_CANDIDATE_EXPANSIONS; expansion++)
+        {
+            int addedCount = expandCandidates(problem, solution, sourceLimits);
+            if(addedCount == 0)
+                break;
+
+            solution.processPositionUpdate(problem);
+            bool improved = polishSolution(solution, problem);
+            printf("Added %d candidates for under-served requirements, fitness is now %.2f\n",
+                    addedCount, solution.fitness);
+            if(!improved)
+                break;
+        }
+    }
+    return solution;
+}
+
+bool loadDataset(const char* dataName, InputData& input)
+{
+    char sourceFilename[MAX_FILEPATH_LENGTH];
+    snprintf(sourceFilename, MAX_FILEPATH_LENGTH, "data/%s_sources.csv", dataName);
+    if(!loadSourceData(sourceFilename, input))
+    {
+        printf("Error: Unable to load source data from %s\n", sourceFilename);
+        return false;
+    }
+    printf("Loaded %zd sources\n", input.sources.size());
+
+    char balancePoolFilename[MAX_FILEPATH_LENGTH];
+    snprintf(balancePoolFilename, MAX_FILEPATH_LENGTH, "data/%s_balancepools.csv", dataName);
+    if(!loadBalancePoolData(balancePoolFilename, input))
+    {
+        printf("Error: Unable to load balance pool data from %s\n", balancePoolFilename);
+        return false;
+    }
+    printf("Loaded %zd balance pools\n", input.balancePools.size());
+
+    char requirementFilename[MAX_FILEPATH_LENGTH];
+    snprintf(requirementFilename, MAX_FILEPATH_LENGTH, "data/%s_requirements.csv", dataName);
+    if(!loadRequirementData(requirementFilename, input))
+    {
+        printf("Error: Unable to load requirement data from %s\n", requirementFilename);
+        return false;
+    }
+    printf("Loaded %zd requirements\n", input.requirements.size());
+    return true;
+}
+
+void prepareProblem(ProblemInstance& problem)
+{
+    // Create allocations and set the source/requirement/balancePool that they correspond to
+    // NOTE: First allocations are from balance pools in our valid allocation list
+    enumerateAllocations(problem, problem.options.topK);
+
+    sortRequirements(problem.input);
+
+    // NOTE: The bound can take much longer than solving big problems, so it is skippable
+    if(problem.options.skipBound)
+        return;
+    double boundStartTime = steadyClockSeconds();
+    float lowerBound = computeLowerBound(problem);
+    printf("Lower bound of %.2f computed in %.2fs\n",
+            lowerBound, steadyClockSeconds() - boundStartTime);
+}
+
+Vector solveProblem(ProblemInstance& problem)
+{
+    int validAllocationCount = (int)problem.allocations.size();
+
+    Vector solution;
+    if(problem.options.skipPresolve)
+    {
+        printf("Computing values for %d allocations...\n", validAllocationCount);
+        solution = solveAllocations(problem);
+    }
+    else
+    {
+        // NOTE: The solver works on the presolved problem as if it were the whole input, and then
+        //       we map its solution back onto the full allocation table before polishing
+        ReducedProblem presolved;
+        presolveProblem(problem, presolved);
+        int reducedAllocationCount = (int)presolved.instance.allocations.size();
+        printf("Computing values for %d allocations (presolved from %d)...\n",
+                reducedAllocationCount, validAllocationCount);
+
+        Vector reducedSolution = solveAllocations(presolved.instance);
+        solution = restoreSolution(presolved, reducedSolution, problem);
+    }
+    if((problem.initialSolution.dimensions > 0) && !SOLVER_IS_BASELINE)
+        solution = keepBetterSolution(problem, solution);
+    return polishProblemSolution(problem, solution);
+}
+
+bool loadWarmStart(const char* filename, ProblemInstance& problem)
+{
+    ProblemInstance previous;
+    Vector previousSolution;
+    InputDelta delta;
+    size_t filenameLength = strlen(filename);
+    bool isOutputFile = (filenameLength >= 5) &&
+                        (strcmp(filename + filenameLength - 5, ".json") == 0);
+    if(isOutputFile)
+    {
+        previousSolution = loadOutputData(filename, previous.input, previous.allocations);
+        computeInputDelta(previous.input, problem.input, delta);
+    }
+    else
+    {
+        // NOTE: The allocations refer to the problem's own input, so anything that refers to
+        //       something that isn't in it is left empty
+        previousSolution = loadAllocationData(filename, previous.allocations);
+        previous.input = problem.input;
+        computeInputDelta(previous.input, problem.input, delta);
+
+        const InputData& input = problem.input;
+        for(int allocIndex=0; allocIndex<(int)previous.allocations.size(); allocIndex++)
+        {
+            AllocationPointer& alloc = previous.allocations[allocIndex];
+            bool isValid = (alloc.requirementIndex >= 0) &&
+                           (alloc.requirementIndex < (int)input.requirements.size()) &&
+                           (alloc.sourceIndex < (int)input.sources.size()) &&
+                           (alloc.balancePoolIndex < (int)input.balancePools.size()) &&
+                           ((alloc.sourceIndex >= 0) != (alloc.balancePoolIndex >= 0));
+            if(!isValid)
+                alloc.setTenor(previousSolution, 0.0f);
+        }
+    }
+    if(previousSolution.dimensions == 0)
+    {
+        printf("Error: Unable to load a solution to warm start from %s\n", filename);
+        if(isOutputFile)
+            freeInputStrings(previous.input);
+        return false;
+    }
+
+    vector<bool> affectedRequirements;
+    vector<bool> affectedSources;
+    problem.initialSolution = patchSolution(previous, previousSolution, delta, problem,
+                                            affectedRequirements, affectedSources);
+    problem.initialSolution.processPositionUpdate(problem);
+    printf("Warm starting from %s, which has fitness %.2f\n",
+           filename, problem.initialSolution.fitness);
+    if(isOutputFile)
+        freeInputStrings(previous.input);
+    return true;
+}
+
+Vector solveProblemIncrementally(ProblemInstance& problem, const ProblemInstance& previous,
+                                 const Vector& previousSolution)
+{
+    InputDelta delta;
+    computeInputDelta(previous.input, problem.input, delta);
+    printf("Added or changed %d sources, %d balance pools and %d requirements\n",
+           countChanged(delta.sourceChanged), countChanged(delta.balancePoolChanged),
+           countChanged(delta.requirementChanged));
+    printf("Removed %d sources, %d balance pools and %d requirements\n",
+           countRemoved(delta.sourceMap), countRemoved(delta.balancePoolMap),
+           countRemoved(delta.requirementMap));
+
+    vector<bool> affectedRequirements;
+    vector<bool> affectedSources;
+    Vector solution = patchSolution(previous, previousSolution, delta, problem,
+                                    affectedRequirements, affectedSources);
+
+    ReducedProblem affected;
+    problem.initialSolution = solution;
+    bool hasAffected = extractAffectedProblem(problem, affectedRequirements, affectedSources,
+                                              affected);
+    problem.initialSolution = Vector();
+    if(hasAffected)
+    {
+        ProblemInstance& affectedProblem = affected.instance;
+        Vector affectedSolution = solveAllocations(affectedProblem);
+        affectedSolution = keepBetterSolution(affectedProblem, affectedSolution);
+
+        for(int i=0; i<(int)affectedProblem.allocations.size(); i++)
+        {
+            AllocationPointer& alloc = problem.allocations[affected.originalAllocations[i]];
+            AllocationPointer& affectedAlloc = affectedProblem.allocations[i];
+            alloc.setStartDate(solution, affectedAlloc.getStartDate(affectedSolution));
+            alloc.setTenor(solution, affectedAlloc.getTenor(affectedSolution));
+            alloc.setAmount(solution, affectedAlloc.getAmount(affectedSolution));
+        }
+    }
+    return polishProblemSolution(problem, solution);
+}
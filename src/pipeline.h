@@ -0,0 +1,42 @@
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include "fundmatch.h"
+
+// Loads data/<dataName>_sources.csv, data/<dataName>_balancepools.csv and
+// data/<dataName>_requirements.csv into the given input.
+// Returns true iff all of them were loaded, otherwise an error has been printed.
+bool loadDataset(const char* dataName, InputData& input);
+
+// Creates the allocations for the problem's input (using its options) and computes its lower
+// bound (unless the options skip it), after which any number of copies of the problem can be solved
+void prepareProblem(ProblemInstance& problem);
+
+// Solves the given prepared problem: presolves it, solves what is left with the solver (in rolling
+// windows and/or independent components, as the options say), maps that back onto the whole
+// allocation table and then polishes it (giving under-served requirements more candidates when
+// the options limit them).
+// NOTE: Candidate expansion adds allocations to the problem, so the solution is for the problem
+//       as it is afterwards. A baseline solver's solution is returned unpolished.
+Vector solveProblem(ProblemInstance& problem);
+
+// Loads a solution from an earlier run, either from an output.json (if the filename ends in .json)
+// or from an allocations CSV (see loadAllocationData), and makes it the problem's initial
+// solution. The solvers then start from it rather than from scratch, and the result of
+// solveProblem is never worse than it.
+// An output.json is mapped onto the problem in the same way as by solveProblemIncrementally, so
+// it still helps when the input has changed since. An allocations CSV has to refer to the
+// problem's own sources, balance pools and requirements by ID.
+// Returns true iff the solution was loaded, otherwise an error has been printed.
+bool loadWarmStart(const char* filename, ProblemInstance& problem);
+
+// Solves the given prepared problem again after its input has changed, starting from a solution
+// of the previous problem (whose input only needs the fields that writeOutputData includes). The
+// previous solution is mapped onto the problem's allocation table, then only the independent
+// components that the changes affect are re-solved, starting from the mapped solution, and the
+// result is polished in the same way as by solveProblem. See incremental.h.
+// NOTE: The affected components aren't presolved, so that the mapped solution can be used as it is
+Vector solveProblemIncrementally(ProblemInstance& problem, const ProblemInstance& previous,
+                                 const Vector& previousSolution);
+
+#endif // _PIPELINE_H
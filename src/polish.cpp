@@ -0,0 +1,305 @@
+#include <assert.h>
+#include <math.h>
+#include <float.h>
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "polish.h"
+#include "fundmatch.h"
+#include "ledger.h"
+
+using namespace std;
+
+// NOTE: We work entirely in whole months and whole amounts here, so the cost of a solution is a
+//       sum over months of the allocation costs plus the RCF cost of each requirement's shortfall.
+//       Moving a single allocation only changes the months that it covers, so we can evaluate
+//       each move incrementally from the amount allocated to each requirement in each month.
+struct PolishState
+{
+    const InputData* input;
+    CapacityLedger ledger;
+    vector<int> coverOffset; // Index into cover of the first month of each requirement
+    vector<float> cover; // The amount allocated to each requirement, in each month of its tenor
+};
+
+struct AllocationValues
+{
+    int startDate;
+    int tenor;
+    float amount;
+};
+
+static float allocationInterestRate(const InputData& input, const AllocationPointer& alloc)
+{
+    if(alloc.sourceIndex >= 0)
+        return input.sources[alloc.sourceIndex].interestRate;
+    return BALANCEPOOL_INTEREST_RATE;
+}
+
+static bool isEmpty(const AllocationValues& values)
+{
+    return (values.tenor <= 0) || (values.amount <= 0.0f);
+}
+
+static AllocationValues getValues(const AllocationPointer& alloc, const Vector& position)
+{
+    AllocationValues result;
+    result.startDate = (int)alloc.getStartDate(position);
+    result.tenor = (int)alloc.getTenor(position);
+    result.amount = alloc.getAmount(position);
+    return result;
+}
+
+static void setValues(AllocationPointer& alloc, Vector& position, const AllocationValues& values)
+{
+    alloc.setStartDate(position, (float)values.startDate);
+    alloc.setTenor(position, (float)values.tenor);
+    alloc.setAmount(position, values.amount);
+}
+
+static void applyCover(PolishState& state, const AllocationPointer& alloc,
+                       const AllocationValues& values, float sign)
+{
+    if(isEmpty(values))
+        return;
+
+    const RequirementInfo& req = state.input->requirements[alloc.requirementIndex];
+    int fromMonth = max(values.startDate, req.startDate);
+    int toMonth = min(values.startDate + values.tenor, req.startDate + req.tenor);
+    int offset = state.coverOffset[alloc.requirementIndex] - req.startDate;
+    for(int month=fromMonth; month<toMonth; month++)
+        state.cover[offset + month] += sign*values.amount;
+}
+
+// Returns the amount by which the given requirement is under-allocated in the given month
+static float requirementShortfall(const PolishState& state, int reqIndex, int month)
+{
+    const RequirementInfo& req = state.input->requirements[reqIndex];
+    if((month < req.startDate) || (month >= req.startDate + req.tenor))
+        return 0.0f;
+
+    float covered = state.cover[state.coverOffset[reqIndex] + month - req.startDate];
+    return max((float)req.amount - covered, 0.0f);
+}
+
+// Returns the change in total cost from adding the given allocation values to the solution
+// NOTE: The allocation itself must not currently be included in the state
+static float allocationCost(const PolishState& state, const AllocationPointer& alloc,
+                            const AllocationValues& values)
+{
+    if(isEmpty(values))
+        return 0.0f;
+
+    float interestRate = allocationInterestRate(*state.input, alloc);
+    float result = values.amount * (float)values.tenor * interestRate;
+    for(int month=values.startDate; month<values.startDate+values.tenor; month++)
+    {
+        float shortfall = requirementShortfall(state, alloc.requirementIndex, month);
+        result -= min(values.amount, shortfall) * RCF_INTEREST_RATE;
+    }
+    return result;
+}
+
+// Returns the cheapest feasible amount for an allocation over the given months
+static float optimalAmount(const PolishState& state, const AllocationPointer& alloc,
+                           const Vector& position, int startDate, int tenor)
+{
+    if(tenor <= 0)
+        return 0.0f;
+
+    // NOTE: Increasing the amount costs interestRate*tenor and saves RCF_INTEREST_RATE in each
+    //       month that is still short by more than the amount, so the best amount is the
+    //       (K+1)-th largest monthly shortfall, where K months of RCF interest are enough to pay
+    //       for the interest over the whole tenor
+    vector<float> shortfalls(tenor);
+    for(int i=0; i<tenor; i++)
+        shortfalls[i] = requirementShortfall(state, alloc.requirementIndex, startDate + i);
+    sort(shortfalls.begin(), shortfalls.end(), greater<float>());
+
+    float interestRate = allocationInterestRate(*state.input, alloc);
+    int unprofitableMonths = (int)floorf(interestRate * (float)tenor / RCF_INTEREST_RATE);
+    float result = 0.0f;
+    if(unprofitableMonths < tenor)
+        result = shortfalls[unprofitableMonths];
+
+    float available = state.ledger.availableAmount(alloc, startDate, startDate + tenor);
+    result = min(result, alloc.getMaxAmount(*state.input, position));
+    result = min(result, floorf(available));
+    return max(result, 0.0f);
+}
+
+// Finds the cheapest feasible range of months for an allocation with the given amount.
+// Returns false (leaving startDate and tenor unchanged) if every range of months costs more than
+// not allocating anything.
+static bool optimalDates(const PolishState& state, const AllocationPointer& alloc, float amount,
+                         int& startDate, int& tenor)
+{
+    if(amount <= 0.0f)
+        return false;
+
+    int windowStart = (int)alloc.getMinStartDate(*state.input);
+    int windowEnd = allocationWindowEnd(*state.input, alloc);
+    float interestRate = allocationInterestRate(*state.input, alloc);
+
+    // NOTE: This is a maximum-sum subarray search over the per-month saving, which restarts
+    //       whenever there isn't enough available to cover the amount in a particular month
+    float bestSaving = 0.0f;
+    int bestStart = -1;
+    int bestEnd = -1;
+    float currentSaving = 0.0f;
+    int currentStart = windowStart;
+    for(int month=windowStart; month<windowEnd; month++)
+    {
+        if(state.ledger.availableAmount(alloc, month, month+1) < amount)
+        {
+            currentSaving = 0.0f;
+            currentStart = month+1;
+            continue;
+        }
+
+        float shortfall = requirementShortfall(state, alloc.requirementIndex, month);
+        float monthSaving = (min(amount, shortfall) * RCF_INTEREST_RATE) - (amount * interestRate);
+        if(currentSaving <= 0.0f)
+        {
+            currentSaving = 0.0f;
+            currentStart = month;
+        }
+        currentSaving += monthSaving;
+        if(currentSaving > bestSaving)
+        {
+            bestSaving = currentSaving;
+            bestStart = currentStart;
+            bestEnd = month+1;
+        }
+    }
+
+    if(bestStart < 0)
+        return false;
+    startDate = bestStart;
+    tenor = bestEnd - bestStart;
+    return true;
+}
+
+// Returns the best values for the given allocation, given all of the other allocations
+static AllocationValues improveAllocation(const PolishState& state, const AllocationPointer& alloc,
+                                          const Vector& position, AllocationValues values)
+{
+    if(isEmpty(values))
+    {
+        // NOTE: An empty allocation has no dates to start from, so we look for the largest amount
+        //       that could be useful in any single month and then find the best dates for that
+        int windowStart = (int)alloc.getMinStartDate(*state.input);
+        int windowEnd = allocationWindowEnd(*state.input, alloc);
+        float startAmount = 0.0f;
+        for(int month=windowStart; month<windowEnd; month++)
+        {
+            float shortfall = requirementShortfall(state, alloc.requirementIndex, month);
+            float available = state.ledger.availableAmount(alloc, month, month+1);
+            startAmount = max(startAmount, min(shortfall, available));
+        }
+        startAmount = floorf(min(startAmount, alloc.getMaxAmount(*state.input, position)));
+
+        AllocationValues result = values;
+        if(!optimalDates(state, alloc, startAmount, result.startDate, result.tenor))
+            return values;
+        result.amount = optimalAmount(state, alloc, position, result.startDate, result.tenor);
+        return result;
+    }
+
+    AllocationValues result = values;
+    result.amount = optimalAmount(state, alloc, position, result.startDate, result.tenor);
+    if(optimalDates(state, alloc, result.amount, result.startDate, result.tenor))
+        result.amount = optimalAmount(state, alloc, position, result.startDate, result.tenor);
+    return result;
+}
+
+bool polishSolution(Vector& solution, ProblemInstance& problem, int maxPasses)
+{
+    InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    // NOTE: We start from the same whole-number values that would get written to the output file,
+    //       and make sure that they're still feasible after rounding
+    Vector polished = solution;
+    for(int allocID=0; allocID<allocCount; allocID++)
+    {
+        AllocationPointer& alloc = allocations[allocID];
+        AllocationValues values;
+        values.startDate = (int)(alloc.getStartDate(solution) + 0.5f);
+        values.tenor = (int)(alloc.getTenor(solution) + 0.5f);
+        values.amount = (float)(int)(alloc.getAmount(solution) + 0.5f);
+        if(isEmpty(values))
+        {
+            values.startDate = (int)alloc.getMinStartDate(input);
+            values.tenor = 0;
+            values.amount = 0.0f;
+        }
+        setValues(alloc, polished, values);
+    }
+
+    PolishState state;
+    state.input = &input;
+    repairPosition(polished, state.ledger, problem);
+    state.coverOffset.resize(input.requirements.size());
+    int totalCoverMonths = 0;
+    for(int reqID=0; reqID<input.requirements.size(); reqID++)
+    {
+        state.coverOffset[reqID] = totalCoverMonths;
+        totalCoverMonths += max(input.requirements[reqID].tenor, 0);
+    }
+    state.cover.assign(totalCoverMonths, 0.0f);
+    for(int allocID=0; allocID<allocCount; allocID++)
+    {
+        AllocationPointer& alloc = allocations[allocID];
+        applyCover(state, alloc, getValues(alloc, polished), 1.0f);
+    }
+
+    for(int pass=0; pass<maxPasses; pass++)
+    {
+        float passImprovement = 0.0f;
+        for(int allocID=0; allocID<allocCount; allocID++)
+        {
+            AllocationPointer& alloc = allocations[allocID];
+            AllocationValues currentValues = getValues(alloc, polished);
+            state.ledger.removeAllocation(alloc, polished);
+            applyCover(state, alloc, currentValues, -1.0f);
+
+            AllocationValues newValues = improveAllocation(state, alloc, polished, currentValues);
+            float currentCost = allocationCost(state, alloc, currentValues);
+            float newCost = allocationCost(state, alloc, newValues);
+            if(newCost < currentCost - 0.001f)
+            {
+                if(isEmpty(newValues))
+                {
+                    newValues.tenor = 0;
+                    newValues.amount = 0.0f;
+                }
+                setValues(alloc, polished, newValues);
+                passImprovement += currentCost - newCost;
+                currentValues = newValues;
+            }
+
+            state.ledger.addAllocation(alloc, polished);
+            applyCover(state, alloc, currentValues, 1.0f);
+        }
+
+        if(passImprovement < 0.01f)
+            break;
+    }
+
+    polished.processPositionUpdate(problem);
+    float originalViolation = measureConstraintViolation(solution, problem);
+    float originalFitness = FLT_MAX;
+    if(originalViolation == 0.0f)
+        originalFitness = computeFitness(solution, problem);
+
+    if((polished.constraintViolation == 0.0f) && (polished.fitness < originalFitness))
+    {
+        solution = polished;
+        return true;
+    }
+    return false;
+}
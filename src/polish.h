@@ -0,0 +1,17 @@
+#ifndef _POLISH_H
+#define _POLISH_H
+
+#include "fundmatch.h"
+
+const int MAX_POLISH_PASSES = 20;
+
+// Improves the given solution by greedy coordinate descent over the allocations. Each allocation
+// in turn has its amount set to the cheapest feasible value for its current dates, and its dates
+// set to the cheapest feasible range of months for its current amount, given all of the other
+// allocations. This is repeated until a full pass over the allocations no longer helps.
+// The solution is only replaced if the polished solution is feasible and either the solution
+// wasn't or the polished solution is strictly better. Returns true iff the solution was replaced.
+// NOTE: At most maxPasses passes are made, solvers that polish many solutions can use fewer
+bool polishSolution(Vector& solution, ProblemInstance& problem, int maxPasses=MAX_POLISH_PASSES);
+
+#endif // _POLISH_H
@@ -0,0 +1,150 @@
+#include <assert.h>
+
+#include <vector>
+
+#include "presolve.h"
+#include "fundmatch.h"
+
+using namespace std;
+
+void compactProblem(const ProblemInstance& original, ReducedProblem& problem)
+{
+    const InputData& originalInput = original.input;
+    ProblemInstance& instance = problem.instance;
+    instance.options = original.options;
+    instance.lowerBound = original.lowerBound;
+
+    vector<int> sourceMap(originalInput.sources.size(), -1);
+    vector<int> requirementMap(originalInput.requirements.size(), -1);
+    for(int allocIndex=0; allocIndex<(int)instance.allocations.size(); allocIndex++)
+    {
+        AllocationPointer& alloc = instance.allocations[allocIndex];
+        if(alloc.sourceIndex >= 0)
+            sourceMap[alloc.sourceIndex] = 0;
+        requirementMap[alloc.requirementIndex] = 0;
+    }
+
+    instance.input.sources.clear();
+    for(int srcIndex=0; srcIndex<(int)originalInput.sources.size(); srcIndex++)
+    {
+        if(sourceMap[srcIndex] < 0)
+            continue;
+        sourceMap[srcIndex] = (int)instance.input.sources.size();
+        instance.input.sources.push_back(originalInput.sources[srcIndex]);
+    }
+    instance.input.requirements.clear();
+    problem.originalRequirements.clear();
+    for(int reqIndex=0; reqIndex<(int)originalInput.requirements.size(); reqIndex++)
+    {
+        if(requirementMap[reqIndex] < 0)
+            continue;
+        requirementMap[reqIndex] = (int)instance.input.requirements.size();
+        instance.input.requirements.push_back(originalInput.requirements[reqIndex]);
+        problem.originalRequirements.push_back(reqIndex);
+    }
+    sortRequirements(instance.input);
+
+    for(int allocIndex=0; allocIndex<(int)instance.allocations.size(); allocIndex++)
+    {
+        AllocationPointer& alloc = instance.allocations[allocIndex];
+        if(alloc.sourceIndex >= 0)
+            alloc.sourceIndex = sourceMap[alloc.sourceIndex];
+        alloc.requirementIndex = requirementMap[alloc.requirementIndex];
+        alloc.allocStartDimension = allocIndex*DIMENSIONS_PER_ALLOCATION;
+    }
+
+    instance.initialSolution = Vector();
+    const Vector& originalSolution = original.initialSolution;
+    if(originalSolution.dimensions > 0)
+    {
+        int allocCount = (int)instance.allocations.size();
+        Vector initialSolution(allocCount * DIMENSIONS_PER_ALLOCATION);
+        for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+        {
+            AllocationPointer& alloc = instance.allocations[allocIndex];
+            int originalIndex = problem.originalAllocations[allocIndex];
+            const AllocationPointer& originalAlloc = original.allocations[originalIndex];
+            alloc.setStartDate(initialSolution, originalAlloc.getStartDate(originalSolution));
+            alloc.setTenor(initialSolution, originalAlloc.getTenor(originalSolution));
+            alloc.setAmount(initialSolution, originalAlloc.getAmount(originalSolution));
+        }
+        instance.initialSolution = initialSolution;
+    }
+}
+
+void presolveProblem(ProblemInstance& problem, ReducedProblem& result)
+{
+    InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+    int reqCount = (int)input.requirements.size();
+    int poolCount = (int)input.balancePools.size();
+    result.instance.allocations.clear();
+    result.originalAllocations.clear();
+
+    bool keepBalancePools = (poolCount > 0) && (BALANCEPOOL_INTEREST_RATE < RCF_INTEREST_RATE);
+    if(keepBalancePools)
+        result.instance.input.balancePools = input.balancePools;
+    else
+        result.instance.input.balancePools.clear();
+
+    // NOTE: The full table starts with poolCount allocations for every requirement (in order of
+    //       requirement), which keep their pool since compacting the problem leaves pools as they are
+    assert(allocCount >= reqCount*poolCount);
+    for(int allocIndex=0; keepBalancePools && (allocIndex<reqCount*poolCount); allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        assert(alloc.balancePoolIndex >= 0);
+        BalancePoolInfo& pool = input.balancePools[alloc.balancePoolIndex];
+        RequirementInfo& req = input.requirements[alloc.requirementIndex];
+        if((pool.amount <= 0) || (req.amount <= 0) || (req.tenor < 1))
+            continue;
+
+        result.instance.allocations.push_back(alloc);
+        result.originalAllocations.push_back(allocIndex);
+    }
+
+    for(int allocIndex=reqCount*poolCount; allocIndex<allocCount; allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        assert(alloc.sourceIndex >= 0);
+        SourceInfo& src = input.sources[alloc.sourceIndex];
+        RequirementInfo& req = input.requirements[alloc.requirementIndex];
+        if((src.interestRate >= RCF_INTEREST_RATE) || (src.amount <= 0) || (req.amount <= 0))
+            continue;
+
+        result.instance.allocations.push_back(alloc);
+        result.originalAllocations.push_back(allocIndex);
+    }
+
+    compactProblem(problem, result);
+}
+
+Vector restoreSolution(const ReducedProblem& presolved, const Vector& reducedSolution,
+                       ProblemInstance& problem)
+{
+    InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    Vector result(allocCount * DIMENSIONS_PER_ALLOCATION);
+    for(int allocIndex=0; allocIndex<allocCount; allocIndex++)
+    {
+        AllocationPointer& alloc = allocations[allocIndex];
+        alloc.setStartDate(result, alloc.getMinStartDate(input));
+        alloc.setTenor(result, 0.0f);
+        alloc.setAmount(result, 0.0f);
+    }
+
+    const vector<AllocationPointer>& reducedAllocations = presolved.instance.allocations;
+    for(int reducedIndex=0; reducedIndex<(int)reducedAllocations.size(); reducedIndex++)
+    {
+        const AllocationPointer& reducedAlloc = reducedAllocations[reducedIndex];
+        AllocationPointer& alloc = allocations[presolved.originalAllocations[reducedIndex]];
+        alloc.setStartDate(result, reducedAlloc.getStartDate(reducedSolution));
+        alloc.setTenor(result, reducedAlloc.getTenor(reducedSolution));
+        alloc.setAmount(result, reducedAlloc.getAmount(reducedSolution));
+    }
+
+    return result;
+}
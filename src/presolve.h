@@ -0,0 +1,43 @@
+#ifndef _PRESOLVE_H
+#define _PRESOLVE_H
+
+#include <vector>
+
+#include "fundmatch.h"
+
+// A self-contained problem made up of some of the allocations of another (original) problem, that
+// a solver can work on as if it were the whole input
+struct ReducedProblem
+{
+    ProblemInstance instance;
+
+    std::vector<int> originalAllocations;  // The index in the original table of each allocation
+    std::vector<int> originalRequirements; // The index in the original input of each requirement
+};
+
+// Makes the given problem self-contained. Its allocations must refer to sources and requirements
+// by their index in the original problem, and to its own balance pools (which must already be set).
+// Afterwards its input only has the sources and requirements that its allocations refer to (in
+// the same order as in the original input), and its allocations refer to those. It also gets the
+// options and lower bound of the original problem, along with the part of the original problem's
+// initial solution (if it has one) that covers its allocations.
+void compactProblem(const ProblemInstance& original, ReducedProblem& problem);
+
+// Builds a reduced problem from the given problem, by:
+// - Removing allocations that can never lower the cost of a solution: those from sources whose
+//   interest rate is no lower than that of the RCF (or that have nothing to give), those to
+//   requirements that need nothing, and those from balance pools if the balance pool interest rate
+//   is no lower than that of the RCF (or the pool has nothing to give)
+// - Removing every source and requirement that no longer has any allocations
+// Every allocation that is kept is exactly as it is in the original problem, so the reduced problem
+// has the same optimal cost. If the problem has an initial solution then the reduced problem gets
+// the part of it that covers the allocations that are kept.
+// NOTE: The allocation table must be in the order given by enumerateAllocations
+void presolveProblem(ProblemInstance& problem, ReducedProblem& result);
+
+// Maps a solution of the presolved problem back onto the allocation table of the original problem.
+// Every allocation that was removed by presolving is left empty.
+Vector restoreSolution(const ReducedProblem& presolved, const Vector& reducedSolution,
+                       ProblemInstance& problem);
+
+#endif // _PRESOLVE_H
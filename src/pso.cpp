@@ -4,45 +4,381 @@
 #include <assert.h>
 #include <float.h>
 
-#include <random>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include <algorithm>
 
 #include "pso.h"
+#include "bounds.h"
 #include "fundmatch.h"
+#include "ledger.h"
 #include "logging.h"
+#include "parallel.h"
+#include "random.h"
+#include "timing.h"
 
 using namespace std;
 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PSO_X86_KERNELS 1
+// NOTE: GCC would otherwise fuse the multiplies and adds in the AVX-512 kernel (which changes the
+//       rounding), Clang only fuses within a single expression so it doesn't need this
+#if defined(__clang__)
+#define PSO_NO_FP_CONTRACT
+#else
+#define PSO_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#endif
+#else
+// NOTE: On other compilers/architectures we just use the scalar kernel
+#define PSO_X86_KERNELS 0
+#endif
+
+const char* const SOLVER_NAME = "pso";
+const bool SOLVER_IS_PARALLEL = true;
+const bool SOLVER_IS_BASELINE = false;
+
 static FileLogger plotLog = FileLogger("pso_fitness.dat");
-static random_device randDevice;
 
-Particle::Particle()
-    : position(0), velocity(0), bestSeenLoc(0)
+Particle::Particle(int dimCount, float* positionCoords, float* velocityCoords, float* bestSeenCoords)
+    : position(dimCount, positionCoords), velocity(dimCount, velocityCoords),
+      bestSeenLoc(dimCount, bestSeenCoords), neighbourBestIndex(0)
 {
 }
 
-Particle::Particle(int dimCount)
-    : position(dimCount), velocity(dimCount), bestSeenLoc(dimCount)
+Swarm::Swarm(int swarmSize, int dimCount)
+    : particleCount(swarmSize), dimensionCount(dimCount),
+      positionData(swarmSize*dimCount), velocityData(swarmSize*dimCount),
+      bestSeenData(swarmSize*dimCount)
+{
+    // NOTE: We reserve space for every particle up front so that the particles never get moved
+    //       (and so copied out of the matrices) once they've been created
+    particles.reserve(swarmSize);
+    for(int i=0; i<swarmSize; i++)
+    {
+        int rowStart = i*dimCount;
+        particles.emplace_back(dimCount, positionData.data() + rowStart,
+                               velocityData.data() + rowStart, bestSeenData.data() + rowStart);
+    }
+}
+
+// Applies the constricted velocity update to a single particle and then moves it, where
+// selfDraws and neighbourDraws contain the uniform random factors for each dimension
+// NOTE: The SIMD kernels do exactly the same operations in exactly the same order (and without
+//       fused multiply-adds) so every kernel gives exactly the same result for a given seed
+typedef void (*ParticleUpdateKernel)(float* position, float* velocity,
+                                     const float* selfBest, const float* neighbourBest,
+                                     const float* selfDraws, const float* neighbourDraws,
+                                     int dimCount);
+
+static void updateParticleScalar(float* position, float* velocity,
+                                 const float* selfBest, const float* neighbourBest,
+                                 const float* selfDraws, const float* neighbourDraws,
+                                 int dimCount)
+{
+    for(int dim=0; dim<dimCount; dim++)
+    {
+        float selfFactor = SELF_BEST_FACTOR * selfDraws[dim];
+        float neighbourFactor = NEIGHBOUR_BEST_FACTOR * neighbourDraws[dim];
+
+        float selfBestOffset = selfBest[dim] - position[dim];
+        float neighbourBestOffset = neighbourBest[dim] - position[dim];
+
+        velocity[dim] = CONSTRICTION_COEFFICIENT * (
+            velocity[dim] +
+            (selfFactor * selfBestOffset) +
+            (neighbourFactor * neighbourBestOffset)
+            );
+        position[dim] += velocity[dim];
+    }
+}
+
+#if PSO_X86_KERNELS
+__attribute__((target("avx2"))) PSO_NO_FP_CONTRACT
+static void updateParticleAVX2(float* position, float* velocity,
+                               const float* selfBest, const float* neighbourBest,
+                               const float* selfDraws, const float* neighbourDraws,
+                               int dimCount)
 {
+    const __m256 selfBestFactor = _mm256_set1_ps(SELF_BEST_FACTOR);
+    const __m256 neighbourBestFactor = _mm256_set1_ps(NEIGHBOUR_BEST_FACTOR);
+    const __m256 constriction = _mm256_set1_ps(CONSTRICTION_COEFFICIENT);
+
+    int dim = 0;
+    for(; dim+8<=dimCount; dim+=8)
+    {
+        __m256 pos = _mm256_loadu_ps(position + dim);
+        __m256 vel = _mm256_loadu_ps(velocity + dim);
+        __m256 selfFactor = _mm256_mul_ps(selfBestFactor, _mm256_loadu_ps(selfDraws + dim));
+        __m256 neighbourFactor = _mm256_mul_ps(neighbourBestFactor,
+                                               _mm256_loadu_ps(neighbourDraws + dim));
+        __m256 selfBestOffset = _mm256_sub_ps(_mm256_loadu_ps(selfBest + dim), pos);
+        __m256 neighbourBestOffset = _mm256_sub_ps(_mm256_loadu_ps(neighbourBest + dim), pos);
+
+        __m256 sum = _mm256_add_ps(vel, _mm256_mul_ps(selfFactor, selfBestOffset));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(neighbourFactor, neighbourBestOffset));
+        vel = _mm256_mul_ps(constriction, sum);
+        _mm256_storeu_ps(velocity + dim, vel);
+        _mm256_storeu_ps(position + dim, _mm256_add_ps(pos, vel));
+    }
+
+    updateParticleScalar(position + dim, velocity + dim, selfBest + dim, neighbourBest + dim,
+                         selfDraws + dim, neighbourDraws + dim, dimCount - dim);
 }
 
-Vector optimizeSwarm(Particle* swarm, int dimensionCount,
-                  int allocCount, AllocationPointer* allocations)
+__attribute__((target("avx512f"))) PSO_NO_FP_CONTRACT
+static void updateParticleAVX512(float* position, float* velocity,
+                                 const float* selfBest, const float* neighbourBest,
+                                 const float* selfDraws, const float* neighbourDraws,
+                                 int dimCount)
 {
-    mt19937 rng(randDevice());
-    uniform_real_distribution<float> uniformf(0.0f, 1.0f);
+    const __m512 selfBestFactor = _mm512_set1_ps(SELF_BEST_FACTOR);
+    const __m512 neighbourBestFactor = _mm512_set1_ps(NEIGHBOUR_BEST_FACTOR);
+    const __m512 constriction = _mm512_set1_ps(CONSTRICTION_COEFFICIENT);
+
+    int dim = 0;
+    for(; dim+16<=dimCount; dim+=16)
+    {
+        __m512 pos = _mm512_loadu_ps(position + dim);
+        __m512 vel = _mm512_loadu_ps(velocity + dim);
+        __m512 selfFactor = _mm512_mul_ps(selfBestFactor, _mm512_loadu_ps(selfDraws + dim));
+        __m512 neighbourFactor = _mm512_mul_ps(neighbourBestFactor,
+                                               _mm512_loadu_ps(neighbourDraws + dim));
+        __m512 selfBestOffset = _mm512_sub_ps(_mm512_loadu_ps(selfBest + dim), pos);
+        __m512 neighbourBestOffset = _mm512_sub_ps(_mm512_loadu_ps(neighbourBest + dim), pos);
+
+        __m512 sum = _mm512_add_ps(vel, _mm512_mul_ps(selfFactor, selfBestOffset));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(neighbourFactor, neighbourBestOffset));
+        vel = _mm512_mul_ps(constriction, sum);
+        _mm512_storeu_ps(velocity + dim, vel);
+        _mm512_storeu_ps(position + dim, _mm512_add_ps(pos, vel));
+    }
+
+    updateParticleScalar(position + dim, velocity + dim, selfBest + dim, neighbourBest + dim,
+                         selfDraws + dim, neighbourDraws + dim, dimCount - dim);
+}
+#endif
+
+// Returns the widest particle update kernel that the current CPU supports
+static ParticleUpdateKernel selectParticleUpdateKernel()
+{
+#if PSO_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return updateParticleAVX512;
+    if(__builtin_cpu_supports("avx2"))
+        return updateParticleAVX2;
+#endif
+    return updateParticleScalar;
+}
+
+// The range of sensible values for each dimension, used to project particles onto the lattice
+struct LatticeBounds
+{
+    vector<float> lower;
+    vector<float> upper;
+    vector<float> maxVelocity;
+};
+
+static LatticeBounds computeLatticeBounds(int dimensionCount, ProblemInstance& problem)
+{
+    const InputData& input = problem.input;
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    LatticeBounds bounds;
+    bounds.lower.resize(dimensionCount);
+    bounds.upper.resize(dimensionCount);
+    bounds.maxVelocity.resize(dimensionCount);
+
+    // NOTE: The bounds don't depend on the position, but the setters need one to write into
+    Vector lower(dimensionCount, bounds.lower.data());
+    Vector upper(dimensionCount, bounds.upper.data());
+    for(int allocID=0; allocID<allocCount; allocID++)
+    {
+        AllocationPointer& alloc = allocations[allocID];
+        float minStartDate = alloc.getMinStartDate(input);
+        alloc.setStartDate(lower, minStartDate);
+        alloc.setStartDate(upper, alloc.getMaxStartDate(input));
+        alloc.setTenor(lower, 0.0f);
+        alloc.setTenor(upper, (float)allocationWindowEnd(input, alloc) - minStartDate);
+        alloc.setAmount(lower, 0.0f);
+        alloc.setAmount(upper, alloc.getMaxAmount(input, upper));
+    }
+
+    for(int dim=0; dim<dimensionCount; dim++)
+    {
+        bounds.upper[dim] = max(bounds.upper[dim], bounds.lower[dim]);
+        float range = bounds.upper[dim] - bounds.lower[dim];
+        bounds.maxVelocity[dim] = max(MAX_VELOCITY_FRACTION * range, 1.0f);
+    }
+    return bounds;
+}
+
+// Limits the particle's velocity and then moves it to the nearest whole-number position within
+// the bounds of each of its allocations
+static void projectToLattice(Particle& particle, const LatticeBounds& bounds,
+                             ProblemInstance& problem)
+{
+    int allocCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
+    float* position = particle.position.coords;
+    float* velocity = particle.velocity.coords;
+    for(int dim=0; dim<particle.position.dimensions; dim++)
+    {
+        // NOTE: The kernel has already moved the particle by the unlimited velocity, so we undo
+        //       the excess. Any rounding error here disappears when we round to the lattice.
+        float limitedVelocity = min(max(velocity[dim], -bounds.maxVelocity[dim]),
+                                    bounds.maxVelocity[dim]);
+        float newPosition = roundf(position[dim] + (limitedVelocity - velocity[dim]));
+        float projectedPosition = min(max(newPosition, bounds.lower[dim]), bounds.upper[dim]);
+
+        // NOTE: If we hit a bound then we stop moving that way, rather than continuing to push
+        //       against the bound for the next several iterations
+        if(projectedPosition != newPosition)
+            limitedVelocity = 0.0f;
+
+        position[dim] = projectedPosition;
+        velocity[dim] = limitedVelocity;
+    }
+
+    // The tenor bound depends on the start date, so we only know it after projecting the start
+    for(int allocID=0; allocID<allocCount; allocID++)
+    {
+        AllocationPointer& alloc = allocations[allocID];
+        float maxTenor = (float)allocationWindowEnd(problem.input, alloc) -
+                         alloc.getStartDate(particle.position);
+        if(alloc.getTenor(particle.position) > maxTenor)
+            alloc.setTenor(particle.position, max(maxTenor, 0.0f));
+    }
+}
+
+// Gives every particle its neighbourhood according to TOPOLOGY, along with the reverse lookup
+// NOTE: Random neighbourhoods are drawn from the random streams for the given iteration, so that
+//       they can be re-randomized (rewired) part way through the run
+static void buildNeighbourhoods(Swarm& swarm, uint64_t seed, int iteration)
+{
+    int particleCount = swarm.particleCount;
+
+    // NOTE: For the von Neumann topology we lay the particles out on the squarest grid that they
+    //       fill exactly
+    int gridRows = 1;
+    for(int rows=1; rows*rows<=particleCount; rows++)
+    {
+        if(particleCount % rows == 0)
+            gridRows = rows;
+    }
+    int gridColumns = particleCount/gridRows;
+
+    for(int particleIndex=0; particleIndex<particleCount; particleIndex++)
+    {
+        vector<int>& neighbours = swarm.particles[particleIndex].neighbours;
+        neighbours.clear();
+        neighbours.push_back(particleIndex);
+
+        if(TOPOLOGY == NeighbourhoodTopology::Ring)
+        {
+            neighbours.push_back((particleIndex + particleCount - 1) % particleCount);
+            neighbours.push_back((particleIndex + 1) % particleCount);
+        }
+        else if(TOPOLOGY == NeighbourhoodTopology::VonNeumann)
+        {
+            int row = particleIndex / gridColumns;
+            int column = particleIndex % gridColumns;
+            neighbours.push_back(((row + gridRows - 1) % gridRows)*gridColumns + column);
+            neighbours.push_back(((row + 1) % gridRows)*gridColumns + column);
+            neighbours.push_back(row*gridColumns + (column + gridColumns - 1) % gridColumns);
+            neighbours.push_back(row*gridColumns + (column + 1) % gridColumns);
+        }
+        else if(TOPOLOGY == NeighbourhoodTopology::Random)
+        {
+            RandomStream rng(seed, StreamPurpose::Neighbourhood, iteration, particleIndex);
+            for(int neighbourIndex=1; neighbourIndex<NEIGHBOUR_COUNT; neighbourIndex++)
+            {
+                neighbours.push_back(rng.uniformInt(0, particleCount-1));
+            }
+        }
+        else if(TOPOLOGY == NeighbourhoodTopology::Global)
+        {
+            for(int otherIndex=0; otherIndex<particleCount; otherIndex++)
+            {
+                if(otherIndex != particleIndex)
+                    neighbours.push_back(otherIndex);
+            }
+        }
+
+        // NOTE: Random neighbourhoods (or very small grids) can contain the same particle twice
+        sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+
+    for(int particleIndex=0; particleIndex<particleCount; particleIndex++)
+    {
+        swarm.particles[particleIndex].observers.clear();
+    }
+    for(int particleIndex=0; particleIndex<particleCount; particleIndex++)
+    {
+        const vector<int>& neighbours = swarm.particles[particleIndex].neighbours;
+        for(int neighbourIndex=0; neighbourIndex<(int)neighbours.size(); neighbourIndex++)
+        {
+            swarm.particles[neighbours[neighbourIndex]].observers.push_back(particleIndex);
+        }
+    }
+}
+
+// Recomputes the neighbourhood best of every particle from scratch
+static void computeNeighbourBests(Swarm& swarm)
+{
+    for(int particleIndex=0; particleIndex<swarm.particleCount; particleIndex++)
+    {
+        Particle& particle = swarm.particles[particleIndex];
+        particle.neighbourBestIndex = particle.neighbours[0];
+        for(int neighbourIndex=1; neighbourIndex<(int)particle.neighbours.size(); neighbourIndex++)
+        {
+            int neighbour = particle.neighbours[neighbourIndex];
+            if(isPositionBetter(swarm.particles[neighbour].bestSeenLoc,
+                                swarm.particles[particle.neighbourBestIndex].bestSeenLoc))
+            {
+                particle.neighbourBestIndex = neighbour;
+            }
+        }
+    }
+}
+
+Vector optimizeSwarm(Swarm& swarm, ProblemInstance& problem)
+{
+    int dimensionCount = swarm.dimensionCount;
+    ParticleUpdateKernel updateParticle = selectParticleUpdateKernel();
+    LatticeBounds latticeBounds;
+    if(PROJECT_TO_LATTICE)
+        latticeBounds = computeLatticeBounds(dimensionCount, problem);
 
     // Compute the best position on the initial swarm positions
-    int bestFitnessIndex = 0;
+    // NOTE: Every particle's best seen location starts out at its position, and any position that
+    //       is better than the global best must also be better than its particle's best seen
+    //       location. The global best is therefore always the best seen location of some
+    //       particle, so we just keep track of which particle that is.
+    int bestParticleIndex = 0;
     for(int particleIndex=1; particleIndex<SWARM_SIZE; particleIndex++)
     {
-        if(isPositionBetter(swarm[particleIndex].position, swarm[bestFitnessIndex].position, allocCount, allocations))
+        if(isPositionBetter(swarm.particles[particleIndex].bestSeenLoc,
+                            swarm.particles[bestParticleIndex].bestSeenLoc))
         {
-            bestFitnessIndex = particleIndex;
+            bestParticleIndex = particleIndex;
         }
     }
-    Vector bestLoc = swarm[bestFitnessIndex].position;
-    plotLog.log("%d %.2f\n", -1, bestLoc.fitness);
+    plotLog.log("%d %.2f\n", -1, swarm.particles[bestParticleIndex].bestSeenLoc.fitness);
+
+    buildNeighbourhoods(swarm, problem.options.seed, 0);
+    computeNeighbourBests(swarm);
+
+    vector<CapacityLedger> repairLedgers(SWARM_SIZE);
+
+    // NOTE: The random factors for every dimension of a particle's velocity update are generated
+    //       in bulk at the start of the update, which is much cheaper than drawing them one at a time
+    vector<float> velocityDraws(SWARM_SIZE * 2 * dimensionCount);
 
     for(int iteration=0; iteration<MAX_ITERATIONS; iteration++)
     {
@@ -51,130 +387,373 @@ Vector optimizeSwarm(Particle* swarm, int dimensionCount,
         //       can compare with the correct best at the start of the current iteration
         for(int particleIndex=0; particleIndex<SWARM_SIZE; particleIndex++)
         {
-            Particle& particle = swarm[particleIndex];
-            if(isPositionBetter(particle.position, bestLoc, allocCount, allocations))
-            {
-                bestLoc = particle.position;
-            }
-            if(isPositionBetter(particle.position, particle.bestSeenLoc, allocCount, allocations))
+            Particle& particle = swarm.particles[particleIndex];
+            if(isPositionBetter(particle.position, particle.bestSeenLoc))
             {
                 particle.bestSeenLoc = particle.position;
+                if(isPositionBetter(particle.bestSeenLoc,
+                                    swarm.particles[bestParticleIndex].bestSeenLoc))
+                {
+                    bestParticleIndex = particleIndex;
+                }
+
+                // Update the cached neighbourhood bests of the particles that can see this one
+                for(int observerIndex=0; observerIndex<(int)particle.observers.size(); observerIndex++)
+                {
+                    Particle& observer = swarm.particles[particle.observers[observerIndex]];
+                    if(isPositionBetter(particle.bestSeenLoc,
+                                        swarm.particles[observer.neighbourBestIndex].bestSeenLoc))
+                    {
+                        observer.neighbourBestIndex = particleIndex;
+                    }
+                }
             }
         }
-        plotLog.log("%d %.2f\n", iteration, bestLoc.fitness);
 
-        // Update particle velocities based on known best positions
-        for(int particleIndex=0; particleIndex<SWARM_SIZE; particleIndex++)
+        if((TOPOLOGY == NeighbourhoodTopology::Random) && (REWIRE_INTERVAL > 0) &&
+           (iteration > 0) && (iteration % REWIRE_INTERVAL == 0))
         {
-            Particle& particle = swarm[particleIndex];
-            Vector globalBestLoc = bestLoc;
+            buildNeighbourhoods(swarm, problem.options.seed, iteration);
+            computeNeighbourBests(swarm);
+        }
+        float bestFitness = swarm.particles[bestParticleIndex].bestSeenLoc.fitness;
+        plotLog.log("%d %.2f\n", iteration, bestFitness);
+        if(hasReachedGapTarget(problem, bestFitness))
+        {
+            printf("Reached the gap target after %d iterations\n", iteration);
+            break;
+        }
+        if(hasPassedDeadline(problem))
+        {
+            printf("Reached the deadline after %d iterations\n", iteration);
+            break;
+        }
 
-            // TODO: Just use a pointer here, we're doing a boatload of copying as it stands
-            Vector neighbourBestLoc = particle.neighbours[0]->bestSeenLoc;
-            for(int neighbourIndex=1; neighbourIndex<NEIGHBOUR_COUNT; neighbourIndex++)
+        // Update particle velocities based on known best positions, and then move the particles
+        // NOTE: Each particle only reads the best positions (which don't change in this loop) and
+        //       has its own random stream, so the particles can all be updated in parallel
+        parallelFor(SWARM_SIZE, [&](int particleIndex)
+        {
+            Particle& particle = swarm.particles[particleIndex];
+            RandomStream rng(problem.options.seed, StreamPurpose::Velocity, iteration,
+                             particleIndex);
+            float* selfDraws = &velocityDraws[particleIndex * 2 * dimensionCount];
+            float* neighbourDraws = selfDraws + dimensionCount;
+            rng.fillUniform(selfDraws, 2*dimensionCount);
+
+            const Vector& neighbourBestLoc = swarm.particles[particle.neighbourBestIndex].bestSeenLoc;
+
+            // Update the velocity and do a timestep of particle movement
+            updateParticle(particle.position.coords, particle.velocity.coords,
+                           particle.bestSeenLoc.coords, neighbourBestLoc.coords,
+                           selfDraws, neighbourDraws, dimensionCount);
+            if(PROJECT_TO_LATTICE)
+                projectToLattice(particle, latticeBounds, problem);
+
+            Vector& position = particle.position;
+            position.processPositionUpdate(problem);
+            if(REPAIR_INFEASIBLE && (position.constraintViolation > 0.0f))
             {
-                Particle* neighbour = particle.neighbours[neighbourIndex];
-                if(isPositionBetter(neighbour->bestSeenLoc, neighbourBestLoc, allocCount, allocations))
-                {
-                    neighbourBestLoc = neighbour->bestSeenLoc;
-                }
+                repairPosition(position, repairLedgers[particleIndex], problem);
+                position.processPositionUpdate(problem);
             }
+        });
+    }
+    return swarm.particles[bestParticleIndex].bestSeenLoc;
+}
 
-            for(int dim=0; dim<dimensionCount; dim++)
-            {
-                float selfFactor = SELF_BEST_FACTOR * uniformf(rng);
-                float neighbourFactor = NEIGHBOUR_BEST_FACTOR * uniformf(rng);
+// A particle's best seen location, published so that particles being updated on other threads can
+// read it while the particle itself keeps moving.
+// Each publication is a complete copy in one of a small pool of slots, and readers hold a count
+// on the slot that they are reading so that it is never overwritten while in use. Publishing
+// fills a slot that is neither current nor being read, and then atomically swaps it in.
+// NOTE: A thread only ever holds one slot of a given particle at a time, so a pool with one more
+//       slot than there are threads always has a free slot for the owner to publish into
+class PublishedBest
+{
+public:
+    struct Slot
+    {
+        Vector location;
+        std::atomic<int> readerCount;
+    };
 
-                float selfBestOffset = particle.bestSeenLoc[dim] - particle.position[dim];
-                float neighbourBestOffset = neighbourBestLoc[dim] - particle.position[dim];
+    PublishedBest(int slotCount, const Vector& initialLocation);
+    ~PublishedBest();
 
-                particle.velocity.coords[dim] = CONSTRICTION_COEFFICIENT * (
-                    particle.velocity[dim] +
-                    (selfFactor * selfBestOffset) +
-                    (neighbourFactor * neighbourBestOffset)
-                    );
-            }
+    // Returns the most recently published slot, which won't change until it is released
+    Slot* acquire();
+    void release(Slot* slot);
+
+    // NOTE: This must only be called by the thread that is currently updating the particle
+    void publish(const Vector& location);
+
+private:
+    std::vector<Slot*> slots;
+    std::atomic<Slot*> current;
+};
+
+PublishedBest::PublishedBest(int slotCount, const Vector& initialLocation)
+    : slots(slotCount)
+{
+    for(int i=0; i<slotCount; i++)
+    {
+        slots[i] = new Slot();
+        slots[i]->location = initialLocation;
+        slots[i]->readerCount = 0;
+    }
+    current = slots[0];
+}
+
+PublishedBest::~PublishedBest()
+{
+    for(int i=0; i<(int)slots.size(); i++)
+    {
+        delete slots[i];
+    }
+}
+
+PublishedBest::Slot* PublishedBest::acquire()
+{
+    while(true)
+    {
+        Slot* slot = current.load();
+        slot->readerCount++;
+        // NOTE: If the slot is still current then it was completely filled before it was
+        //       published, and our count now stops it from being reused, so it's safe to read
+        if(current.load() == slot)
+            return slot;
+        slot->readerCount--;
+    }
+}
+
+void PublishedBest::release(Slot* slot)
+{
+    slot->readerCount--;
+}
+
+void PublishedBest::publish(const Vector& location)
+{
+    Slot* currentSlot = current.load();
+    while(true)
+    {
+        for(int i=0; i<(int)slots.size(); i++)
+        {
+            Slot* slot = slots[i];
+            if((slot == currentSlot) || (slot->readerCount.load() != 0))
+                continue;
+
+            slot->location = location;
+            current.store(slot);
+            return;
         }
+        // NOTE: Readers only hold slots very briefly, so we'll find a free one soon enough
+        std::this_thread::yield();
+    }
+}
 
-        // Do a timestep of particle movement
-        for(int particleIndex=0; particleIndex<SWARM_SIZE; particleIndex++)
+// Returns true iff the given particle's best seen location is better than the given published best
+static bool isBestBetterThan(Vector& bestSeenLoc, PublishedBest& otherBest)
+{
+    PublishedBest::Slot* otherSlot = otherBest.acquire();
+    bool result = isPositionBetter(bestSeenLoc, otherSlot->location);
+    otherBest.release(otherSlot);
+    return result;
+}
+
+static Vector optimizeSwarmAsynchronous(Swarm& swarm, ProblemInstance& problem)
+{
+    int dimensionCount = swarm.dimensionCount;
+    ParticleUpdateKernel updateParticle = selectParticleUpdateKernel();
+    LatticeBounds latticeBounds;
+    if(PROJECT_TO_LATTICE)
+        latticeBounds = computeLatticeBounds(dimensionCount, problem);
+    int threadCount = min(parallelThreadCount(), SWARM_SIZE);
+
+    buildNeighbourhoods(swarm, problem.options.seed, 0);
+
+    vector<PublishedBest*> publishedBests(SWARM_SIZE);
+    int initialBestIndex = 0;
+    for(int particleIndex=0; particleIndex<SWARM_SIZE; particleIndex++)
+    {
+        Particle& particle = swarm.particles[particleIndex];
+        publishedBests[particleIndex] = new PublishedBest(threadCount+1, particle.bestSeenLoc);
+        if(isPositionBetter(particle.bestSeenLoc, swarm.particles[initialBestIndex].bestSeenLoc))
+        {
+            initialBestIndex = particleIndex;
+        }
+    }
+    plotLog.log("%d %.2f\n", -1, swarm.particles[initialBestIndex].bestSeenLoc.fitness);
+
+    // NOTE: As in the synchronous version the global best is always the best seen location of
+    //       some particle, so we publish it by atomically swapping in the index of that particle
+    std::atomic<int> bestParticleIndex(initialBestIndex);
+
+    vector<CapacityLedger> repairLedgers(SWARM_SIZE);
+    vector<float> velocityDraws(SWARM_SIZE * 2 * dimensionCount);
+
+    // NOTE: Each thread owns a fixed subset of the particles, and is the only thread that ever
+    //       writes to their positions, velocities and best seen locations. Everything that other
+    //       threads read goes through the published bests.
+    std::atomic<bool> stopSearching(false);
+    parallelFor(threadCount, [&](int threadIndex)
+    {
+        for(int iteration=0; iteration<MAX_ITERATIONS; iteration++)
         {
-            for(int dim=0; dim<dimensionCount; dim++)
+            if(stopSearching.load())
+                break;
+
+            for(int particleIndex=threadIndex; particleIndex<SWARM_SIZE; particleIndex+=threadCount)
             {
-                swarm[particleIndex].position.coords[dim] += swarm[particleIndex].velocity[dim];
+                Particle& particle = swarm.particles[particleIndex];
+                if(isPositionBetter(particle.position, particle.bestSeenLoc))
+                {
+                    particle.bestSeenLoc = particle.position;
+                    publishedBests[particleIndex]->publish(particle.bestSeenLoc);
+
+                    int currentBestIndex = bestParticleIndex.load();
+                    while((currentBestIndex != particleIndex) &&
+                          isBestBetterThan(particle.bestSeenLoc, *publishedBests[currentBestIndex]))
+                    {
+                        // NOTE: On failure this reloads currentBestIndex and we compare again
+                        if(bestParticleIndex.compare_exchange_weak(currentBestIndex, particleIndex))
+                            break;
+                    }
+                }
+
+                // Find the best of whatever our neighbours have published so far
+                PublishedBest* neighbourBest = publishedBests[particle.neighbours[0]];
+                PublishedBest::Slot* neighbourBestSlot = neighbourBest->acquire();
+                for(int neighbourIndex=1; neighbourIndex<(int)particle.neighbours.size(); neighbourIndex++)
+                {
+                    PublishedBest* neighbour = publishedBests[particle.neighbours[neighbourIndex]];
+                    PublishedBest::Slot* neighbourSlot = neighbour->acquire();
+                    if(isPositionBetter(neighbourSlot->location, neighbourBestSlot->location))
+                    {
+                        neighbourBest->release(neighbourBestSlot);
+                        neighbourBest = neighbour;
+                        neighbourBestSlot = neighbourSlot;
+                    }
+                    else
+                    {
+                        neighbour->release(neighbourSlot);
+                    }
+                }
+
+                RandomStream rng(problem.options.seed, StreamPurpose::Velocity, iteration,
+                             particleIndex);
+                float* selfDraws = &velocityDraws[particleIndex * 2 * dimensionCount];
+                float* neighbourDraws = selfDraws + dimensionCount;
+                rng.fillUniform(selfDraws, 2*dimensionCount);
+                updateParticle(particle.position.coords, particle.velocity.coords,
+                               particle.bestSeenLoc.coords, neighbourBestSlot->location.coords,
+                               selfDraws, neighbourDraws, dimensionCount);
+                neighbourBest->release(neighbourBestSlot);
+                if(PROJECT_TO_LATTICE)
+                    projectToLattice(particle, latticeBounds, problem);
+
+                Vector& position = particle.position;
+                position.processPositionUpdate(problem);
+                if(REPAIR_INFEASIBLE && (position.constraintViolation > 0.0f))
+                {
+                    repairPosition(position, repairLedgers[particleIndex], problem);
+                    position.processPositionUpdate(problem);
+                }
             }
 
-            swarm[particleIndex].position.processPositionUpdate(allocCount, allocations);
+            if(threadIndex == 0)
+            {
+                PublishedBest& globalBest = *publishedBests[bestParticleIndex.load()];
+                PublishedBest::Slot* globalBestSlot = globalBest.acquire();
+                plotLog.log("%d %.2f\n", iteration, globalBestSlot->location.fitness);
+                if(hasReachedGapTarget(problem, globalBestSlot->location.fitness))
+                {
+                    printf("Reached the gap target after %d iterations\n", iteration+1);
+                    stopSearching.store(true);
+                }
+                else if(hasPassedDeadline(problem))
+                {
+                    printf("Reached the deadline after %d iterations\n", iteration+1);
+                    stopSearching.store(true);
+                }
+                globalBest.release(globalBestSlot);
+            }
         }
+    });
+
+    // NOTE: All of the threads have finished, so the particles' own best seen locations are
+    //       exactly what they last published
+    Vector result = swarm.particles[bestParticleIndex.load()].bestSeenLoc;
+    for(int particleIndex=0; particleIndex<SWARM_SIZE; particleIndex++)
+    {
+        delete publishedBests[particleIndex];
     }
-    return bestLoc;
+    return result;
 }
 
-Vector computeAllocations(int allocationCount, AllocationPointer* allocations)
+Vector computeAllocations(ProblemInstance& problem)
 {
+    InputData& input = problem.input;
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
+
     // Create the swarm
     int dimensionCount = allocationCount * DIMENSIONS_PER_ALLOCATION;
-    Particle* swarm = new Particle[SWARM_SIZE];
-    for(int i=0; i<SWARM_SIZE; i++)
-    {
-        swarm[i] = Particle(dimensionCount);
-    }
+    Swarm swarm(SWARM_SIZE, dimensionCount);
+    vector<Particle>& particles = swarm.particles;
 
-    RequirementInfo& firstReq = g_input.requirements[g_input.requirementsByStart[0]];
-    RequirementInfo& lastReq = g_input.requirements[g_input.requirementsByEnd[g_input.requirements.size()-1]];
+    RequirementInfo& firstReq = input.requirements[input.requirementsByStart[0]];
+    RequirementInfo& lastReq = input.requirements[input.requirementsByEnd[input.requirements.size()-1]];
     int minReqDate = firstReq.startDate;
     int maxReqDate = lastReq.startDate + lastReq.tenor;
     assert(maxReqDate > minReqDate);
 
-    // Initialize the swarm
-    mt19937 rng(randDevice());
-    uniform_real_distribution<float> centredUniformf(-1.0f, 1.0f);
-    uniform_int_distribution<int> uniformParticleIndex(0, SWARM_SIZE-1); // Endpoints are inclusive
-    for(int i=0; i<SWARM_SIZE; i++)
+    // Initialize the swarm positions
+    // NOTE: Each position is built against its own capacity ledger, so every particle starts out
+    //       feasible and they can all be initialized independently of each other
+    int seededCount = 0;
+    if(problem.initialSolution.dimensions > 0)
+        seededCount = (int)(SEEDED_SWARM_FRACTION*SWARM_SIZE);
+    parallelFor(SWARM_SIZE, [&](int i)
     {
-        int retries = 0;
-        do
+        RandomStream rng(problem.options.seed, StreamPurpose::Initialization, 0, i);
+        CapacityLedger ledger;
+        if((i >= 1) && (i <= seededCount))
         {
-            for(int allocID=0; allocID<allocationCount; allocID++)
-            {
-                initializeAllocation(allocations[allocID], swarm[i].position, rng);
-            }
-        } while((retries++ < 5) &&
-                !isFeasible(swarm[i].position, allocationCount, allocations));
+            particles[i].position = problem.initialSolution;
+            repairPosition(particles[i].position, ledger, problem);
+        }
+        else
+        {
+            initializeFeasiblePosition(particles[i].position, ledger, problem, rng);
+        }
 
         if(i == 0)
         {
             for(int allocID=0; allocID<allocationCount; allocID++)
-                allocations[allocID].setAmount(swarm[0].position, 0.0f);
+                allocations[allocID].setAmount(particles[0].position, 0.0f);
         }
-        swarm[i].position.processPositionUpdate(allocationCount, allocations);
+        particles[i].position.processPositionUpdate(problem);
+    });
 
+    // Initialize the swarm velocities
+    for(int i=0; i<SWARM_SIZE; i++)
+    {
         // Initialize allocation velocity
-        for(int allocID=0; allocID<allocationCount; allocID++)
+        // NOTE: Every allocation has its own 3 contiguous dimensions, so this covers them all
+        RandomStream rng(problem.options.seed, StreamPurpose::Initialization, 1, i);
+        rng.fillUniform(particles[i].velocity.coords, dimensionCount);
+        for(int dim=0; dim<dimensionCount; dim++)
         {
-            float startDateVelocity = centredUniformf(rng) * 0.1f;
-            float tenorVelocity = centredUniformf(rng) * 0.1f;
-            float amountVelocity = centredUniformf(rng) * 0.1f;
-            allocations[allocID].setStartDate(swarm[i].velocity, startDateVelocity);
-            allocations[allocID].setTenor(swarm[i].velocity, tenorVelocity);
-            allocations[allocID].setAmount(swarm[i].velocity, amountVelocity);
+            particles[i].velocity.coords[dim] = (2.0f*particles[i].velocity.coords[dim] - 1.0f) * 0.1f;
         }
 
-        swarm[i].bestSeenLoc = swarm[i].position;
-
-        swarm[i].neighbours[0] = &swarm[i];
-        for(int neighbourIndex=1; neighbourIndex<NEIGHBOUR_COUNT; neighbourIndex++)
-        {
-            swarm[i].neighbours[neighbourIndex] = &swarm[uniformParticleIndex(rng)];
-        }
+        particles[i].bestSeenLoc = particles[i].position;
     }
     printf("Initialization complete\n");
 
     // Run PSO using our new swarm
-    Vector bestSolution = optimizeSwarm(swarm, dimensionCount, allocationCount, allocations);
-
-    // Cleanup
-    delete[] swarm;
-
-    return bestSolution;
+    if(ASYNCHRONOUS_UPDATES)
+        return optimizeSwarmAsynchronous(swarm, problem);
+    return optimizeSwarm(swarm, problem);
 }
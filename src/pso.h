@@ -3,28 +3,89 @@
 
 #include <math.h>
 
+#include <vector>
+
 #include "fundmatch.h"
 
 const int MAX_ITERATIONS = 1000;
 const int SWARM_SIZE = 50;
-const int NEIGHBOUR_COUNT = 7;
+
+// The fraction of the swarm that starts at the problem's initial solution, if it has one
+// NOTE: Those particles still start with different velocities, so they spread out around it
+const float SEEDED_SWARM_FRACTION = 0.25f;
+
+enum class NeighbourhoodTopology
+{
+    Ring,       // Each particle's neighbours are the particles on either side of it
+    VonNeumann, // The particles lie on a 2D torus and their neighbours are the 4 adjacent particles
+    Random,     // Each particle has NEIGHBOUR_COUNT-1 randomly-chosen neighbours
+    Global,     // Every particle is a neighbour of every other particle
+};
+
+const NeighbourhoodTopology TOPOLOGY = NeighbourhoodTopology::Random;
+const int NEIGHBOUR_COUNT = 7; // Only used for random neighbourhoods, includes the particle itself
+const int REWIRE_INTERVAL = 0; // Iterations between re-randomizing random neighbourhoods, 0 for never
 
 const float PHI = 4.1f;
 const float SELF_BEST_FACTOR = PHI/2.0f;
 const float NEIGHBOUR_BEST_FACTOR = PHI/2.0f;
 const float CONSTRICTION_COEFFICIENT = 2.0f/(PHI - 2.0f + sqrtf(PHI*PHI - 4.0f*PHI));
 
+// If true, any particle that moves to an infeasible position is repaired
+const bool REPAIR_INFEASIBLE = true;
+
+// If true, every particle is projected onto the lattice of whole-number values within its
+// allocations' bounds after each step, and its velocity in each dimension is limited to
+// MAX_VELOCITY_FRACTION of the range of that dimension
+const bool PROJECT_TO_LATTICE = true;
+const float MAX_VELOCITY_FRACTION = 0.2f;
+
+// If true, the swarm is split across threads and each particle moves again as soon as it has been
+// evaluated, using whatever bests have been published by then, rather than all particles moving
+// in lock-step iterations
+// NOTE: Random neighbourhoods are never rewired in this mode, and since the bests that a particle
+//       sees depend on the timing of the other threads, the result for a given seed is only
+//       reproducible when running on a single thread
+const bool ASYNCHRONOUS_UPDATES = false;
+
 struct Particle
 {
+    // NOTE: These are all views into the swarm's matrices, see Swarm below
     Vector position;
     Vector velocity;
 
     Vector bestSeenLoc;
 
-    Particle* neighbours[NEIGHBOUR_COUNT];
+    std::vector<int> neighbours; // Indices of the particles in this particle's neighbourhood
+    std::vector<int> observers; // Indices of the particles that have this one as a neighbour
+
+    // The index of the neighbour with the best best seen location
+    // NOTE: Best seen locations only ever get better, so this only needs to be updated when the
+    //       best seen location of one of our neighbours changes
+    int neighbourBestIndex;
+
+    Particle(int dimCount, float* positionCoords, float* velocityCoords, float* bestSeenCoords);
+};
+
+// The positions, velocities and best seen positions of every particle in the swarm are each
+// stored in a single contiguous matrix (with one row per particle), so that the update kernel can
+// stream straight through them and so that particles can refer to each other by index
+struct Swarm
+{
+    int particleCount;
+    int dimensionCount;
+
+    std::vector<float> positionData;
+    std::vector<float> velocityData;
+    std::vector<float> bestSeenData;
+
+    std::vector<Particle> particles;
+
+    Swarm(int particleCount, int dimensionCount);
 
-    Particle();
-    Particle(int dimCount);
+private:
+    Swarm(const Swarm& other); // The particles point into our matrices, so we can't be copied
+    Swarm& operator =(const Swarm& other);
 };
 
 #endif
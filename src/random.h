@@ -0,0 +1,215 @@
+#ifndef _RANDOM_H
+#define _RANDOM_H
+
+#include <stdint.h>
+
+// Identifies what a random stream is used for, so that different parts of a solver never share
+// a stream even when they are given the same iteration/index
+enum class StreamPurpose : uint32_t
+{
+    Initialization,
+    Selection,
+    Crossover,
+    Mutation,
+    Velocity,
+    Neighbourhood,
+    Construction,
+};
+
+// A counter-based random number generator (Philox4x32-10, from Salmon et al. 2011).
+// Every number in a stream is computed directly from the seed, the stream's ID and its position in
+// the stream, so any number of independent streams can be created without any shared state. This
+// lets every individual/particle/thread use its own stream and get the same numbers regardless of
+// which thread it runs on or in what order.
+// NOTE: This satisfies the requirements of a UniformRandomBitGenerator so that it can be used with
+//       the standard library algorithms (e.g std::shuffle)
+class RandomStream
+{
+public:
+    typedef uint32_t result_type;
+
+    // The stream ID is made up of a purpose and two further numbers (typically an iteration and
+    // the index of the individual/particle that the stream is for)
+    RandomStream(uint64_t seed, StreamPurpose purpose, uint32_t iteration=0, uint32_t index=0);
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFF; }
+    result_type operator()();
+
+    // Returns a uniformly-distributed float in [0, 1)
+    float uniformf();
+
+    // Returns a uniformly-distributed integer in [minValue, maxValue] (both endpoints inclusive)
+    int uniformInt(int minValue, int maxValue);
+
+    // Fills the given buffer with the next count random 32-bit words (which can also be used as
+    // random bitmasks, since every bit is independently set with probability 1/2)
+    void fillBits(uint32_t* words, int count);
+
+    // Fills the given buffer with the next count uniformly-distributed floats in [0, 1)
+    // NOTE: Both of these give exactly the same values as calling operator()/uniformf() count
+    //       times, but generate several blocks at once so that the generation can be vectorized
+    void fillUniform(float* values, int count);
+
+private:
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t block[4];
+    int blockIndex;
+};
+
+static const uint32_t PHILOX_M0 = 0xD2511F53;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+static const uint32_t PHILOX_W0 = 0x9E3779B9;
+static const uint32_t PHILOX_W1 = 0xBB67AE85;
+static const int PHILOX_ROUNDS = 10;
+
+// Computes the Philox4x32-10 block for the given counter and key
+inline void philoxBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4])
+{
+    uint32_t x0 = counter[0];
+    uint32_t x1 = counter[1];
+    uint32_t x2 = counter[2];
+    uint32_t x3 = counter[3];
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for(int round=0; round<PHILOX_ROUNDS; round++)
+    {
+        uint64_t product0 = (uint64_t)PHILOX_M0 * (uint64_t)x0;
+        uint64_t product1 = (uint64_t)PHILOX_M1 * (uint64_t)x2;
+        x0 = (uint32_t)(product1 >> 32) ^ x1 ^ k0;
+        x1 = (uint32_t)product1;
+        x2 = (uint32_t)(product0 >> 32) ^ x3 ^ k1;
+        x3 = (uint32_t)product0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    result[0] = x0;
+    result[1] = x1;
+    result[2] = x2;
+    result[3] = x3;
+}
+
+static const int PHILOX_LANES = 8;
+
+// Computes the PHILOX_LANES consecutive Philox4x32-10 blocks starting at the given counter, and
+// writes them to result in the order in which they would be computed one at a time by philoxBlock
+// NOTE: Each block is kept in its own element of the x arrays so that the compiler can vectorize
+//       the rounds across blocks (the 32x32->64 bit multiplies map directly onto pmuludq)
+inline void philoxBlocks(const uint32_t counter[4], const uint32_t key[2],
+                         uint32_t result[4*PHILOX_LANES])
+{
+    uint32_t x0[PHILOX_LANES];
+    uint32_t x1[PHILOX_LANES];
+    uint32_t x2[PHILOX_LANES];
+    uint32_t x3[PHILOX_LANES];
+    for(int lane=0; lane<PHILOX_LANES; lane++)
+    {
+        x0[lane] = counter[0] + (uint32_t)lane;
+        x1[lane] = counter[1];
+        x2[lane] = counter[2];
+        x3[lane] = counter[3];
+    }
+
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for(int round=0; round<PHILOX_ROUNDS; round++)
+    {
+        for(int lane=0; lane<PHILOX_LANES; lane++)
+        {
+            uint64_t product0 = (uint64_t)PHILOX_M0 * (uint64_t)x0[lane];
+            uint64_t product1 = (uint64_t)PHILOX_M1 * (uint64_t)x2[lane];
+            uint32_t newX0 = (uint32_t)(product1 >> 32) ^ x1[lane] ^ k0;
+            uint32_t newX2 = (uint32_t)(product0 >> 32) ^ x3[lane] ^ k1;
+            x1[lane] = (uint32_t)product1;
+            x3[lane] = (uint32_t)product0;
+            x0[lane] = newX0;
+            x2[lane] = newX2;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    for(int lane=0; lane<PHILOX_LANES; lane++)
+    {
+        result[4*lane + 0] = x0[lane];
+        result[4*lane + 1] = x1[lane];
+        result[4*lane + 2] = x2[lane];
+        result[4*lane + 3] = x3[lane];
+    }
+}
+
+inline RandomStream::RandomStream(uint64_t seed, StreamPurpose purpose,
+                                  uint32_t iteration, uint32_t index)
+{
+    key[0] = (uint32_t)seed;
+    key[1] = (uint32_t)(seed >> 32);
+    // NOTE: The first word of the counter is the position in the stream, the rest is the stream ID
+    counter[0] = 0;
+    counter[1] = (uint32_t)purpose;
+    counter[2] = iteration;
+    counter[3] = index;
+    blockIndex = 4;
+}
+
+inline RandomStream::result_type RandomStream::operator()()
+{
+    if(blockIndex == 4)
+    {
+        philoxBlock(counter, key, block);
+        counter[0]++;
+        blockIndex = 0;
+    }
+    return block[blockIndex++];
+}
+
+inline float RandomStream::uniformf()
+{
+    // NOTE: A float only has 24 bits of precision, so we use the top 24 bits to get an exact
+    //       multiple of 2^-24 in [0, 1)
+    return (float)((*this)() >> 8) * (1.0f/16777216.0f);
+}
+
+inline int RandomStream::uniformInt(int minValue, int maxValue)
+{
+    // NOTE: This maps the 32-bit value onto the range with a multiply rather than a modulus, the
+    //       bias is negligible for the range sizes that we use
+    uint64_t rangeSize = (uint64_t)((int64_t)maxValue - (int64_t)minValue + 1);
+    return minValue + (int)(((uint64_t)(*this)() * rangeSize) >> 32);
+}
+
+inline void RandomStream::fillBits(uint32_t* words, int count)
+{
+    // NOTE: We first use up whatever is left of the current block, then generate whole groups of
+    //       blocks directly into the output, and finish off with single blocks as usual
+    int index = 0;
+    while((index < count) && (blockIndex < 4))
+        words[index++] = block[blockIndex++];
+
+    while(count - index >= 4*PHILOX_LANES)
+    {
+        philoxBlocks(counter, key, &words[index]);
+        counter[0] += PHILOX_LANES;
+        index += 4*PHILOX_LANES;
+    }
+
+    while(index < count)
+        words[index++] = (*this)();
+}
+
+inline void RandomStream::fillUniform(float* values, int count)
+{
+    uint32_t bits[4*PHILOX_LANES];
+    for(int chunkStart=0; chunkStart<count; chunkStart+=4*PHILOX_LANES)
+    {
+        int chunkSize = count - chunkStart;
+        if(chunkSize > 4*PHILOX_LANES)
+            chunkSize = 4*PHILOX_LANES;
+
+        fillBits(bits, chunkSize);
+        for(int i=0; i<chunkSize; i++)
+            values[chunkStart + i] = (float)(bits[i] >> 8) * (1.0f/16777216.0f);
+    }
+}
+
+#endif // _RANDOM_H
@@ -0,0 +1,25 @@
+#ifndef _READ_FILE_H
+#define _READ_FILE_H
+
+#include <stdio.h>
+
+#include <string>
+
+// Reads the whole of the given file into contents, as is.
+// Returns true iff the file could be opened.
+inline bool readFile(const std::string& filename, std::string& contents)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(!file)
+        return false;
+
+    char buffer[65536];
+    size_t readCount;
+    contents.clear();
+    while((readCount = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        contents.append(buffer, readCount);
+    fclose(file);
+    return true;
+}
+
+#endif // _READ_FILE_H
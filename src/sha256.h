@@ -0,0 +1,163 @@
+#ifndef _SHA256_H
+#define _SHA256_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <array>
+
+// A SHA-256 digest (FIPS 180-4), which is strong enough that two different inputs are never
+// expected to share one
+typedef std::array<uint8_t, 32> Sha256Digest;
+
+static const uint32_t SHA256_ROUND_CONSTANTS[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+// Computes the SHA-256 digest of everything that is added to it
+class Sha256
+{
+public:
+    Sha256();
+
+    void add(const void* bytes, size_t length);
+
+    // Pads what has been added and returns its digest, after which nothing more can be added
+    Sha256Digest finish();
+
+private:
+    void processBlock(const uint8_t* block);
+
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t bufferLength;
+    uint64_t totalLength;
+};
+
+inline uint32_t sha256RotateRight(uint32_t value, int count)
+{
+    return (value >> count) | (value << (32 - count));
+}
+
+inline Sha256::Sha256()
+    : bufferLength(0), totalLength(0)
+{
+    static const uint32_t INITIAL_STATE[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+    };
+    memcpy(state, INITIAL_STATE, sizeof(state));
+}
+
+inline void Sha256::processBlock(const uint8_t* block)
+{
+    uint32_t w[64];
+    for(int i=0; i<16; i++)
+    {
+        w[i] = ((uint32_t)block[4*i] << 24) | ((uint32_t)block[4*i + 1] << 16) |
+               ((uint32_t)block[4*i + 2] << 8) | (uint32_t)block[4*i + 3];
+    }
+    for(int i=16; i<64; i++)
+    {
+        uint32_t s0 = sha256RotateRight(w[i-15], 7) ^ sha256RotateRight(w[i-15], 18) ^
+                      (w[i-15] >> 3);
+        uint32_t s1 = sha256RotateRight(w[i-2], 17) ^ sha256RotateRight(w[i-2], 19) ^
+                      (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    uint32_t f = state[5];
+    uint32_t g = state[6];
+    uint32_t h = state[7];
+    for(int i=0; i<64; i++)
+    {
+        uint32_t s1 = sha256RotateRight(e, 6) ^ sha256RotateRight(e, 11) ^
+                      sha256RotateRight(e, 25);
+        uint32_t choice = (e & f) ^ (~e & g);
+        uint32_t temp1 = h + s1 + choice + SHA256_ROUND_CONSTANTS[i] + w[i];
+        uint32_t s0 = sha256RotateRight(a, 2) ^ sha256RotateRight(a, 13) ^
+                      sha256RotateRight(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+inline void Sha256::add(const void* bytes, size_t length)
+{
+    const uint8_t* data = (const uint8_t*)bytes;
+    totalLength += length;
+    while(length > 0)
+    {
+        // NOTE: Whole blocks are processed straight from the input when nothing is buffered
+        if((bufferLength == 0) && (length >= 64))
+        {
+            processBlock(data);
+            data += 64;
+            length -= 64;
+            continue;
+        }
+
+        size_t copyLength = 64 - bufferLength;
+        if(copyLength > length)
+            copyLength = length;
+        memcpy(buffer + bufferLength, data, copyLength);
+        bufferLength += copyLength;
+        data += copyLength;
+        length -= copyLength;
+        if(bufferLength == 64)
+        {
+            processBlock(buffer);
+            bufferLength = 0;
+        }
+    }
+}
+
+inline Sha256Digest Sha256::finish()
+{
+    uint64_t bitLength = totalLength*8;
+    uint8_t padding[72] = {0x80};
+    size_t paddingLength = ((bufferLength < 56) ? 56 : 120) - bufferLength;
+    for(int i=0; i<8; i++)
+        padding[paddingLength + i] = (uint8_t)(bitLength >> (56 - 8*i));
+    add(padding, paddingLength + 8);
+
+    Sha256Digest digest;
+    for(int i=0; i<8; i++)
+    {
+        digest[4*i] = (uint8_t)(state[i] >> 24);
+        digest[4*i + 1] = (uint8_t)(state[i] >> 16);
+        digest[4*i + 2] = (uint8_t)(state[i] >> 8);
+        digest[4*i + 3] = (uint8_t)state[i];
+    }
+    return digest;
+}
+
+#endif // _SHA256_H
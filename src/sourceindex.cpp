@@ -0,0 +1,115 @@
+#include <assert.h>
+#include <limits.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "sourceindex.h"
+#include "fundmatch.h"
+
+using namespace std;
+
+static const int NO_END_DATE = INT_MIN; // The end date of a used source (or an empty leaf)
+
+void SourceIndex::build(const InputData& input)
+{
+    int sourceCount = (int)input.sources.size();
+    taxClasses.clear();
+    taxClasses.resize(TAX_CLASS_COUNT);
+    sourcePositions.assign(sourceCount, -1);
+    sourceTaxClasses.resize(sourceCount);
+
+    for(int srcIndex=0; srcIndex<sourceCount; srcIndex++)
+    {
+        // NOTE: Sources with no tenor can never be allocated, so we leave them out entirely
+        const SourceInfo& src = input.sources[srcIndex];
+        sourceTaxClasses[srcIndex] = src.taxClass;
+        if(src.tenor < 1)
+            continue;
+        taxClasses[(int)src.taxClass].sourceIndices.push_back(srcIndex);
+    }
+
+    for(int taxClassIndex=0; taxClassIndex<TAX_CLASS_COUNT; taxClassIndex++)
+    {
+        TaxClassSources& taxClass = taxClasses[taxClassIndex];
+        vector<int>& indices = taxClass.sourceIndices;
+        stable_sort(indices.begin(), indices.end(), [&input](int a, int b)
+        {
+            return input.sources[a].startDate < input.sources[b].startDate;
+        });
+
+        int count = (int)indices.size();
+        taxClass.startDates.resize(count);
+        taxClass.leafCount = 1;
+        while(taxClass.leafCount < count)
+            taxClass.leafCount *= 2;
+        taxClass.maxEndDate.assign(2*taxClass.leafCount, NO_END_DATE);
+
+        for(int position=0; position<count; position++)
+        {
+            const SourceInfo& src = input.sources[indices[position]];
+            taxClass.startDates[position] = src.startDate;
+            taxClass.maxEndDate[taxClass.leafCount + position] = src.startDate + src.tenor;
+            sourcePositions[indices[position]] = position;
+        }
+        for(int node=taxClass.leafCount-1; node>0; node--)
+        {
+            taxClass.maxEndDate[node] = max(taxClass.maxEndDate[2*node],
+                                            taxClass.maxEndDate[2*node + 1]);
+        }
+    }
+}
+
+void SourceIndex::collectOverlapping(const TaxClassSources& taxClass, int node,
+                                     int nodeFrom, int nodeTo, int positionEnd, int minEndDate,
+                                     vector<int>& result) const
+{
+    // NOTE: Every node covers the positions [nodeFrom, nodeTo), we skip any node that contains
+    //       only sources that start too late, or only sources that end too early
+    if((nodeFrom >= positionEnd) || (taxClass.maxEndDate[node] <= minEndDate))
+        return;
+
+    if(nodeTo - nodeFrom == 1)
+    {
+        result.push_back(taxClass.sourceIndices[nodeFrom]);
+        return;
+    }
+
+    int nodeMiddle = (nodeFrom + nodeTo)/2;
+    collectOverlapping(taxClass, 2*node, nodeFrom, nodeMiddle, positionEnd, minEndDate, result);
+    collectOverlapping(taxClass, 2*node + 1, nodeMiddle, nodeTo, positionEnd, minEndDate, result);
+}
+
+void SourceIndex::findOverlappingSources(const RequirementInfo& req, vector<int>& result) const
+{
+    if(req.tenor < 1)
+        return;
+
+    // NOTE: A source overlaps the requirement by at least a month iff it starts before the
+    //       requirement ends and ends after the requirement starts
+    const TaxClassSources& taxClass = taxClasses[(int)req.taxClass];
+    int reqEnd = req.startDate + req.tenor;
+    int positionEnd = (int)(lower_bound(taxClass.startDates.begin(), taxClass.startDates.end(),
+                                        reqEnd) - taxClass.startDates.begin());
+    if(positionEnd == 0)
+        return;
+
+    collectOverlapping(taxClass, 1, 0, taxClass.leafCount, positionEnd, req.startDate, result);
+}
+
+void SourceIndex::markUsed(int sourceIndex)
+{
+    int position = sourcePositions[sourceIndex];
+    if(position < 0)
+        return;
+
+    TaxClassSources& taxClass = taxClasses[(int)sourceTaxClasses[sourceIndex]];
+    int node = taxClass.leafCount + position;
+    taxClass.maxEndDate[node] = NO_END_DATE;
+    for(node/=2; node>0; node/=2)
+    {
+        taxClass.maxEndDate[node] = max(taxClass.maxEndDate[2*node],
+                                        taxClass.maxEndDate[2*node + 1]);
+    }
+    sourcePositions[sourceIndex] = -1;
+}
@@ -0,0 +1,45 @@
+#ifndef _SOURCEINDEX_H
+#define _SOURCEINDEX_H
+
+#include <vector>
+
+#include "fundmatch.h"
+
+// An index over the sources that have not been used yet, which can find every unused source that
+// could be allocated to a given requirement without looking at any of the other sources.
+// The sources of each tax class are sorted by start date, with a segment tree over that order
+// that holds the latest end date of any unused source in each range. A query then only descends
+// into ranges that start early enough and contain a source that ends late enough, so it takes
+// O(log(S) + k*log(S)) time to find the k sources that overlap the requirement.
+class SourceIndex
+{
+public:
+    // Builds the index over all of the sources in the given input, with every source unused
+    void build(const InputData& input);
+
+    // Appends the index of every unused source that has the same tax class as req and overlaps it
+    // by at least one month (IE maxAllocationTenor(source, req) >= 1) to result, in no particular
+    // order
+    void findOverlappingSources(const RequirementInfo& req, std::vector<int>& result) const;
+
+    // Removes the given source from the index, so that it is never returned by another query
+    void markUsed(int sourceIndex);
+
+private:
+    struct TaxClassSources
+    {
+        std::vector<int> sourceIndices; // Sorted by start date
+        std::vector<int> startDates; // The start date of each source in sourceIndices
+        int leafCount; // The number of leaves in the tree (a power of 2)
+        std::vector<int> maxEndDate; // The segment tree, where node i has children 2i and 2i+1
+    };
+
+    void collectOverlapping(const TaxClassSources& taxClass, int node, int nodeFrom, int nodeTo,
+                            int positionEnd, int minEndDate, std::vector<int>& result) const;
+
+    std::vector<TaxClassSources> taxClasses; // Indexed by TaxClass
+    std::vector<int> sourcePositions; // The position of each source in its tax class' order
+    std::vector<TaxClass> sourceTaxClasses; // The tax class of each source
+};
+
+#endif // _SOURCEINDEX_H
@@ -0,0 +1,25 @@
+#ifndef _TIMING_H
+#define _TIMING_H
+
+#include <chrono>
+
+#include "fundmatch.h"
+
+// Returns the current time in seconds on a clock that only ever moves forward, which is what
+// deadlines are given in
+inline double steadyClockSeconds()
+{
+    std::chrono::duration<double> now = std::chrono::steady_clock::now().time_since_epoch();
+    return now.count();
+}
+
+// Returns true iff the problem has a deadline and it has passed, IE solvers should return the best
+// solution that they have found so far
+inline bool hasPassedDeadline(const ProblemInstance& problem)
+{
+    if(problem.options.deadline <= 0.0)
+        return false;
+    return steadyClockSeconds() >= problem.options.deadline;
+}
+
+#endif // _TIMING_H
@@ -9,8 +9,14 @@
 
 using namespace std;
 
-Vector computeAllocations(int allocationCount, AllocationPointer* allocations)
+const char* const SOLVER_NAME = "worstcase";
+const bool SOLVER_IS_PARALLEL = false;
+const bool SOLVER_IS_BASELINE = true;
+
+Vector computeAllocations(ProblemInstance& problem)
 {
+    int allocationCount = (int)problem.allocations.size();
+    AllocationPointer* allocations = problem.allocations.data();
     int dimensionCount = allocationCount * DIMENSIONS_PER_ALLOCATION;
     Vector solution(dimensionCount);
     for(int allocIndex=0; allocIndex<allocationCount; allocIndex++)
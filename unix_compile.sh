@@ -1,6 +1,6 @@
-CompileFlags="-std=c++11 -I ./src -O2"
-HarnessSrcFiles="src/main.cpp src/fundmatch.cpp src/dataio.cpp src/logging.cpp src/Jzon.cpp"
-HarnessObjFiles="main.o fundmatch.o dataio.o logging.o Jzon.o"
+CompileFlags="-std=c++11 -I ./src -O2 -pthread"
+HarnessSrcFiles="src/main.cpp src/pipeline.cpp src/daemon.cpp src/fundmatch.cpp src/ledger.cpp src/polish.cpp src/candidates.cpp src/presolve.cpp src/decompose.cpp src/horizon.cpp src/incremental.cpp src/greedy.cpp src/flow.cpp src/bounds.cpp src/sourceindex.cpp src/dataio.cpp src/logging.cpp src/Jzon.cpp"
+HarnessObjFiles="main.o pipeline.o daemon.o fundmatch.o ledger.o polish.o candidates.o presolve.o decompose.o horizon.o incremental.o greedy.o flow.o bounds.o sourceindex.o dataio.o logging.o Jzon.o"
 
 mkdir -p build
 g++ -c $CompileFlags $HarnessSrcFiles
@@ -8,4 +8,7 @@ g++ $CompileFlags -o build/pso src/pso.cpp $HarnessObjFiles
 g++ $CompileFlags -o build/ga src/ga.cpp $HarnessObjFiles
 g++ $CompileFlags -o build/heuristic src/heuristic.cpp $HarnessObjFiles
 g++ $CompileFlags -o build/worstcase src/worstcase.cpp $HarnessObjFiles
+g++ $CompileFlags -o build/mcf src/mcf.cpp $HarnessObjFiles
+g++ $CompileFlags -o build/grasp src/grasp.cpp $HarnessObjFiles
+g++ $CompileFlags -o build/client src/client.cpp Jzon.o
 rm *.o